@@ -58,6 +58,8 @@ struct console_t {
   char txt_entrada[N_COL+1];
   char fila_de_comandos_externos[N_CMD_EXT];
   FILE *arquivo_de_log;
+  registro_t *registro;
+  bool usa_tela;
 };
 
 
@@ -66,7 +68,7 @@ struct console_t {
 // ---------------------------------------------------------------------
 
 static console_t *console_global; // gambiarra para simplificar o uso de prints na console
-console_t *console_cria(void)
+console_t *console_cria(registro_t *registro)
 {
   console_t *self = malloc(sizeof(*self));
   assert(self != NULL);
@@ -88,8 +90,10 @@ console_t *console_cria(void)
   strcpy(self->txt_entrada, "");
   self->fila_de_comandos_externos[0] = '\0';
   self->arquivo_de_log = fopen("log_da_console", "w");
+  self->registro = registro;
+  self->usa_tela = registro_modo(registro) != REG_REPRODUZ;
 
-  tela_init();
+  if (self->usa_tela) tela_init();
 
   return self;
 }
@@ -98,14 +102,16 @@ static void console_desenha(console_t *self);
 
 void console_destroi(console_t *self)
 {
-  console_desenha(self);
   if (self->arquivo_de_log != NULL) fclose(self->arquivo_de_log);
-  tela_puts(COR_OCUPADO, "  digite ENTER para sair  ");
-  tela_atualiza();
-  while (tela_tecla() != '\n') {
-    ;
+  if (self->usa_tela) {
+    console_desenha(self);
+    tela_puts(COR_OCUPADO, "  digite ENTER para sair  ");
+    tela_atualiza();
+    while (tela_tecla() != '\n') {
+      ;
+    }
+    tela_fim();
   }
-  tela_fim();
 
   for (int t = 0; t < N_TERM; t++) {
     terminal_destroi(self->term[t]);
@@ -126,6 +132,14 @@ terminal_t *console_terminal(console_t *self, char id_terminal)
   return self->term[num_terminal];
 }
 
+void console_snapshot(console_t *self, snapshot_t *snap)
+{
+  snapshot_confere(snap, N_TERM);
+  for (int t = 0; t < N_TERM; t++) {
+    terminal_snapshot(self->term[t], snap);
+  }
+}
+
 static void atualiza_terminais(console_t *self)
 {
   for (int t = 0; t < N_TERM; t++) {
@@ -247,6 +261,7 @@ static void interpreta_linha_entrada(console_t *self)
   // 1     executa uma instrução
   // C     continua a execução
   // F     fim da simulação
+  // S     salva um snapshot da máquina
 
   char *linha = self->txt_entrada;
   console_printf("CMD: '%s'", linha);
@@ -261,12 +276,13 @@ static void interpreta_linha_entrada(console_t *self)
       break;
     case 'D':
       val = atoi(&linha[1]);
-      tela_espera(val);
+      if (self->usa_tela) tela_espera(val);
       break;
     case 'P':
     case '1':
     case 'C':
     case 'F':
+    case 'S':
       insere_comando_externo(self, cmd);
       break;
     default:
@@ -278,7 +294,7 @@ static void interpreta_linha_entrada(console_t *self)
 // lê e guarda um caractere do teclado; interpreta linha se for 'enter'
 static void verifica_entrada(console_t *self)
 {
-  char ch = tela_tecla();
+  char ch = registro_tecla(self->registro, self->usa_tela ? tela_tecla() : 0);
 
   int l = strlen(self->txt_entrada);
 
@@ -297,6 +313,8 @@ static void verifica_entrada(console_t *self)
 char console_comando_externo(console_t *self)
 {
   verifica_entrada(self);
+  // na reprodução, a simulação termina quando acabam as teclas gravadas
+  if (registro_terminou(self->registro)) insere_comando_externo(self, 'F');
   return remove_comando_externo(self);
 }
 
@@ -343,7 +361,7 @@ static void desenha_console(console_t *self)
 
 static void desenha_entrada(console_t *self)
 {
-  char txt_fixo[] = "P=para C=continua 1=passo F=fim  Ets=entra Zt=zera";
+  char txt_fixo[] = "P=para C=continua 1=passo F=fim S=salva  Ets=entra Zt=zera";
   tela_posiciona(LINHA_ENTRADA, 0);
   tela_puts(COR_ENTRADA, ""); // gambiarra para limpar na cor certa
   tela_limpa_linha();
@@ -373,7 +391,14 @@ void console_tictac(console_t *self)
 {
   verifica_entrada(self);
   atualiza_terminais(self);
-  console_desenha(self);
+  if (self->usa_tela) console_desenha(self);
+}
+
+void console_avanca_terminais(console_t *self, int n)
+{
+  for (int i = 0; i < n; i++) {
+    atualiza_terminais(self);
+  }
 }
 
 // vim: foldmethod=marker
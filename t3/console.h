@@ -8,11 +8,14 @@
 
 #include <stdbool.h>
 #include "terminal.h"
+#include "registro.h"
 
 typedef struct console_t console_t;
 
 // cria e inicializa a console
-console_t *console_cria(void);
+// as teclas lidas passam pelo 'registro' (ver registro.h); se ele estiver
+//   em modo de reprodução, a console não usa a tela nem o teclado
+console_t *console_cria(registro_t *registro);
 
 // destrói a console
 void console_destroi(console_t *self);
@@ -30,14 +33,24 @@ void console_print_status(console_t *self, char *txt);
 //   'P': para a execução,
 //   '1': executa uma instrução,
 //   'C': continua a execução,
-//   'F': finaliza a simulação.
+//   'F': finaliza a simulação,
+//   'S': salva um snapshot da máquina (ver snapshot.h).
 // retorna '\0' caso não tenha comando externo digitado
 char console_comando_externo(console_t *self);
 
 // retorna o terminal identificado ('A', 'B', etc)
 terminal_t *console_terminal(console_t *self, char id_terminal);
 
+// salva ou carrega o estado dos terminais (ver snapshot.h)
+void console_snapshot(console_t *self, snapshot_t *snap);
+
 // esta função deve ser chamada periodicamente para que tela funcione
 void console_tictac(console_t *self);
 
+// faz os terminais avançarem n unidades de tempo, sem ler o teclado nem
+//   redesenhar a tela
+// usado pelo controlador quando avança o tempo de uma vez com as CPUs paradas,
+//   para que os terminais andem como se cada unidade fosse um tictac
+void console_avanca_terminais(console_t *self, int n);
+
 #endif // CONSOLE_H
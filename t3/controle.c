@@ -10,14 +10,23 @@
 #include <stdio.h>
 #include <assert.h>
 
+// número máximo de instruções executadas entre duas atualizações da console
+#define INSTRUCOES_POR_LOTE 1000
+
 struct controle_t {
-  cpu_t *cpu;
+  // as CPUs; a primeira é a mostrada na linha de estado
+  cpu_t *cpu[MAX_CPUS];
+  int n_cpus;
   relogio_t *relogio;
   console_t *console;
   enum { executando, passo, parado, fim } estado;
+  // função e argumento para salvar um snapshot
+  func_snapshot_t func_snapshot;
+  void *arg_snapshot;
 };
 
 // funções auxiliares
+static void controle_executa_lote(controle_t *self);
 static void controle_processa_comandos_da_console(controle_t *self);
 static void controle_atualiza_estado_na_console(controle_t *self);
 
@@ -27,10 +36,12 @@ controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio)
   controle_t *self = malloc(sizeof(*self));
   assert(self != NULL);
 
-  self->cpu = cpu;
+  self->cpu[0] = cpu;
+  self->n_cpus = 1;
   self->console = console;
   self->relogio = relogio;
   self->estado = parado;
+  self->func_snapshot = NULL;
 
   return self;
 }
@@ -40,23 +51,26 @@ void controle_destroi(controle_t *self)
   free(self);
 }
 
+void controle_adiciona_cpu(controle_t *self, cpu_t *cpu)
+{
+  assert(self->n_cpus < MAX_CPUS);
+  self->cpu[self->n_cpus++] = cpu;
+}
+
+void controle_define_snapshot(controle_t *self, func_snapshot_t func, void *arg)
+{
+  self->func_snapshot = func;
+  self->arg_snapshot = arg;
+}
+
 void controle_laco(controle_t *self)
 {
-  // executa uma instrução por vez até a console dizer que chega
+  // executa um lote de instruções por vez até a console dizer que chega
   do {
     if (self->estado == passo || self->estado == executando) {
-      cpu_executa_1(self->cpu);
-      relogio_tictac(self->relogio);
+      controle_executa_lote(self);
 
       if (self->estado == passo) self->estado = parado;
-
-      // enquanto não tem controlador de interrupção, fala direto com o relógio
-      // o dispositivo 3 do relógio contém 1 se o timer expirou
-      int tem_int;
-      relogio_leitura(self->relogio, 3, &tem_int);
-      if (tem_int != 0) {
-        cpu_interrompe(self->cpu, IRQ_RELOGIO);
-      }
     }
     console_tictac(self->console);
 
@@ -68,6 +82,53 @@ void controle_laco(controle_t *self)
 }
  
 
+// executa instruções até acontecer algo que interesse ao resto do
+//   hardware (ver cpu_executa_n), e avança o relógio de acordo
+// com várias CPUs, cada uma executa seu lote (uma depois da outra, mas
+//   simulando execução em paralelo), e o relógio avança o tempo do lote
+//   mais longo; uma CPU que para antes (em E/S ou interrupção) fica
+//   esperando o fim do lote
+// se todas as CPUs estão paradas, avança o relógio de uma vez até o fim do
+//   lote, em vez de uma unidade de tempo por volta do laço
+// nos dois casos os terminais andam uma vez por unidade de tempo do lote,
+//   como se cada instrução tivesse uma volta do laço, então a simulação é a
+//   mesma que com uma instrução por vez
+static void controle_executa_lote(controle_t *self)
+{
+  int n = self->estado == passo ? 1 : INSTRUCOES_POR_LOTE;
+  // o lote não passa do instante em que o relógio vai pedir interrupção
+  int t_ate_interrupcao;
+  relogio_leitura(self->relogio, 2, &t_ate_interrupcao);
+  if (t_ate_interrupcao > 0 && t_ate_interrupcao < n) n = t_ate_interrupcao;
+
+  int executadas = 0;
+  for (int c = 0; c < self->n_cpus; c++) {
+    int executadas_cpu = cpu_executa_n(self->cpu[c], n);
+    if (executadas_cpu > executadas) executadas = executadas_cpu;
+  }
+  if (executadas == 0) {
+    // com todas as CPUs paradas nada acontece até a próxima interrupção do
+    //   relógio (o lote já termina nela): o tempo avança direto para lá
+    executadas = n;
+  }
+  relogio_avanca(self->relogio, executadas);
+  // os terminais andam o que andariam com um tictac da console por unidade
+  //   de tempo (o último é o do laço de controle)
+  console_avanca_terminais(self->console, executadas - 1);
+
+  // enquanto não tem controlador de interrupção, fala direto com o relógio
+  // o dispositivo 3 do relógio contém 1 se o timer expirou
+  // a interrupção vai para todas as CPUs que a aceitarem; uma CPU que está
+  //   tratando outra interrupção recebe enquanto o SO não desligar o pedido
+  int tem_int;
+  relogio_leitura(self->relogio, 3, &tem_int);
+  if (tem_int != 0) {
+    for (int c = 0; c < self->n_cpus; c++) {
+      cpu_interrompe(self->cpu[c], IRQ_RELOGIO);
+    }
+  }
+}
+
 static void controle_processa_comandos_da_console(controle_t *self)
 {
   char cmd = console_comando_externo(self->console);
@@ -84,6 +145,14 @@ static void controle_processa_comandos_da_console(controle_t *self)
     case 'C':
       self->estado = executando;
       break;
+    case 'S':
+      // o snapshot é feito entre dois lotes, nunca no meio de uma instrução
+      if (self->func_snapshot == NULL) {
+        console_printf("Snapshot não disponível");
+      } else if (!self->func_snapshot(self->arg_snapshot)) {
+        console_printf("Erro ao salvar o snapshot");
+      }
+      break;
   }
 }
 
@@ -96,6 +165,6 @@ static void controle_atualiza_estado_na_console(controle_t *self)
     case executando: strcpy(status, "EXEC   | "); break;
     case passo:      strcpy(status, "PASSO  | "); break;
   }
-  cpu_concatena_descricao(self->cpu, status);
+  cpu_concatena_descricao(self->cpu[0], status);
   console_print_status(self->console, status);
 }
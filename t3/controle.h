@@ -15,6 +15,19 @@ typedef struct controle_t controle_t;
 controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio);
 void controle_destroi(controle_t *self);
 
+// acrescenta mais uma CPU a ser controlada (até MAX_CPUS)
+// as CPUs executam em paralelo: a cada passo do relógio, cada uma executa
+//   uma instrução; as interrupções do relógio são enviadas a todas
+void controle_adiciona_cpu(controle_t *self, cpu_t *cpu);
+
+// tipo da função chamada para salvar um snapshot da máquina
+// retorna true se conseguiu salvar
+typedef bool (*func_snapshot_t)(void *arg);
+
+// define a função a chamar quando o operador pede um snapshot (comando 'S'
+//   da console), e o argumento a passar para ela
+void controle_define_snapshot(controle_t *self, func_snapshot_t func, void *arg);
+
 // o laço principal da simulação
 void controle_laco(controle_t *self);
 
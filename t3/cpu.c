@@ -8,8 +8,10 @@
 // ---------------------------------------------------------------------
 
 #include "cpu.h"
+#include "console.h"
 #include "err.h"
 #include "instrucao.h"
+#include "perfil.h"
 
 #include <stdbool.h>
 #include <stdlib.h>
@@ -22,6 +24,87 @@
 // DECLARAÇÃO {{{1
 // ---------------------------------------------------------------------
 
+// número de entradas no cache de blocos básicos
+// tem que ser potência de 2 (o índice é obtido com uma máscara sobre o PC)
+#define CPU_TAM_CACHE 256
+
+// número máximo de instruções em um bloco básico
+#define CPU_MAX_INSTR_BLOCO 32
+
+// número de opcodes de instruções (sem as pseudo-instruções do montador)
+#define CPU_N_INSTR (CHAMAC + 1)
+
+// número de sequências de instruções mais executadas no relatório do perfil
+#define CPU_N_PERFIL 10
+
+// função que implementa uma instrução
+typedef void (*cpu_op_t)(cpu_t *self);
+
+// as superinstruções: sequências de instruções executadas juntas (ver
+//   SUPERINSTRUÇÕES)
+typedef enum {
+  FUS_TRAX_ARMM_TRAX,
+  FUS_CPXA_SUB_DESVNZ,
+  FUS_CPXA_RESTO_DESVNZ,
+  FUS_CARGM_SOMA_ARMM,
+  FUS_CARGM_TRAX,
+  FUS_CARGI_TRAX,
+  FUS_INCX_CPXA,
+  N_FUSOES
+} fusao_id_t;
+typedef struct fusao_t fusao_t;
+
+// uma instrução pré-decodificada (uma micro-operação de um bloco)
+typedef struct {
+  int opcode;
+  bool es;              // a instrução acessa dispositivos (ver cpu_executa_n)
+  bool escreve;         // a instrução escreve na memória
+  bool tem_A1;          // A1 já foi lido da memória
+  int A1;
+  cpu_op_t executa;
+  // superinstrução que começa nesta instrução, ou NULL
+  fusao_t *fusao;
+#ifdef CPU_NUCLEO_DIRETO
+  // endereço do código que executa a instrução no núcleo com despacho direto
+  //   (preenchido pelo núcleo na primeira execução do bloco)
+  void *rotulo;
+#endif
+} instr_decod_t;
+
+// um bloco básico: instruções consecutivas no mesmo quadro, terminando na
+//   primeira que desvia, acessa dispositivo, muda o modo da CPU ou para
+// o bloco é identificado pelo espaço de endereçamento (a tabela de páginas,
+//   ou NULL para endereços físicos), pelo modo da CPU e pelo endereço da
+//   primeira instrução, e só vale enquanto a tabela não for alterada e o
+//   quadro que contém as instruções não for escrito
+// a tradução do endereço das instruções e a verificação de privilégio são
+//   feitas na construção do bloco, não na execução
+typedef struct bloco_t bloco_t;
+struct bloco_t {
+  // identificação
+  bool valido;
+  tabpag_t *tabpag;
+  cpu_modo_t modo;
+  int PC;
+  // validade
+  unsigned versao_tabpag;
+  int quadro;
+  unsigned versao_quadro;
+  // página virtual das instruções, para marcar o acesso
+  int pagina;
+  // encadeamento: endereços onde a execução continua depois do bloco (em
+  //   sequência e no destino do desvio, -1 se não conhecido) e os blocos que
+  //   começam neles, se já foram procurados (podem não ser mais válidos)
+  int PC_saida[2];
+  bloco_t *saida[2];
+  // as instruções; tem uma posição a mais para a marca de fim de bloco do
+  //   núcleo com despacho direto
+  int n_instr;
+  instr_decod_t instr[CPU_MAX_INSTR_BLOCO + 1];
+  // número de vezes que o bloco foi executado, ainda não contado no perfil
+  long execucoes;
+};
+
 // uma CPU tem estado, memória, controlador de ES
 struct cpu_t {
   // registradores
@@ -40,6 +123,23 @@ struct cpu_t {
   // função e argumento para implementar instrução CHAMAC
   func_chamaC_t func_chamaC;
   void *arg_chamaC;
+  // cache de blocos básicos
+  bloco_t blocos[CPU_TAM_CACHE];
+  // instrução em execução (em um bloco ou em 'instr_avulsa')
+  instr_decod_t *instr;
+  // para instruções que não podem ser colocadas em um bloco
+  instr_decod_t instr_avulsa;
+  // perfil de execução: quantas vezes cada sequência de 2 e de 3 opcodes
+  //   foi executada
+  long perfil_pares[CPU_N_INSTR][CPU_N_INSTR];
+  long perfil_trios[CPU_N_INSTR][CPU_N_INSTR][CPU_N_INSTR];
+  // quantas vezes cada superinstrução foi executada completa
+  long fusoes_executadas[N_FUSOES];
+#ifdef CPU_PERFIL
+  // perfil de execução por endereço, e o processo em execução em modo usuário
+  perfil_t *perfil;
+  int pid;
+#endif
 };
 
 
@@ -74,21 +174,49 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
   self->privilegiadas[RETI] = true;
   self->privilegiadas[CHAMAC] = true;
 
+  // cache começa vazio
+  memset(self->blocos, 0, sizeof(self->blocos));
+  memset(&self->instr_avulsa, 0, sizeof(self->instr_avulsa));
+  self->instr = &self->instr_avulsa;
+  memset(self->perfil_pares, 0, sizeof(self->perfil_pares));
+  memset(self->perfil_trios, 0, sizeof(self->perfil_trios));
+  memset(self->fusoes_executadas, 0, sizeof(self->fusoes_executadas));
+#ifdef CPU_PERFIL
+  self->perfil = perfil_cria();
+  self->pid = PERFIL_PID_SO;
+#endif
+
   return self;
 }
 
 void cpu_destroi(cpu_t *self)
 {
   // quem criou mmu e e/s que destrua!
+#ifdef CPU_PERFIL
+  perfil_destroi(self->perfil);
+#endif
   free(self);
 }
 
+void cpu_dorme(cpu_t *self)
+{
+  self->erro = ERR_CPU_PARADA;
+}
+
 void cpu_define_chamaC(cpu_t *self, func_chamaC_t func_chamaC, void *arg_chamaC)
 {
   self->func_chamaC = func_chamaC;
   self->arg_chamaC = arg_chamaC;
 }
 
+void cpu_define_processo(cpu_t *self, int pid, char *nome_prog)
+{
+#ifdef CPU_PERFIL
+  self->pid = pid;
+  perfil_define_programa(self->perfil, pid, nome_prog);
+#endif
+}
+
 
 // ---------------------------------------------------------------------
 // DESCRIÇÃO {{{1
@@ -188,22 +316,14 @@ static bool poe_es(cpu_t *self, int dispositivo, int val)
   return false;
 }
 
-// lê o opcode da instrução no PC
-// retorna true se ele pode ser executado, ou põe em erro o motivo de não poder
-static bool pega_opcode(cpu_t *self, int *popc)
-{
-  // não pode executar se houver erro na leitura da memória
-  if (!pega_mem(self, self->PC, popc)) return false;
-  // pode executar se tiver privilégio para isso
-  if (self->modo == supervisor || !self->privilegiadas[*popc]) return true;
-  // não pode executar instrução privilegiada em modo usuário
-  self->erro = ERR_INSTR_PRIV;
-  return false;
-}
-
 // lê o argumento 1 da instrução no PC
+// usa o valor pré-decodificado, se a instrução tiver vindo do cache
 static bool pega_A1(cpu_t *self, int *pA1)
 {
+  if (self->instr->tem_A1) {
+    *pA1 = self->instr->A1;
+    return true;
+  }
   return pega_mem(self, self->PC + 1, pA1);
 }
 
@@ -448,52 +568,466 @@ static void op_CHAMAS(cpu_t *self) // chamada de sistema
 
 
 // ---------------------------------------------------------------------
-// EXECUÇÃO DE UMA INSTRUÇÃO {{{1
+// SUPERINSTRUÇÕES {{{1
+// ---------------------------------------------------------------------
+
+// sequências frequentes de instruções (ver o perfil no relatório da CPU) são
+//   executadas por uma só função, ou um só rótulo no núcleo com despacho
+//   direto, economizando o despacho das outras instruções da sequência
+// o efeito é o mesmo de executar as instruções uma a uma: se uma delas causar
+//   erro, as anteriores já foram executadas e o PC aponta para ela
+// as instruções continuam no bloco, e são executadas uma a uma quando a
+//   sequência não cabe no que falta do lote
+
+// executa a superinstrução que começa em 'instr'
+// retorna o número de instruções executadas (inclusive a que causou erro)
+typedef int (*cpu_op_fusao_t)(cpu_t *self, instr_decod_t *instr);
+
+struct fusao_t {
+  int n_instr;
+  int opcodes[3];
+  // índice da instrução que escreve na memória, -1 se nenhuma
+  int escrita;
+  cpu_op_fusao_t executa;
+};
+
+static int fus_TRAX_ARMM_TRAX(cpu_t *self, instr_decod_t *instr)
+{
+  // salva X sem alterar A nem X (início de trata_int.asm)
+  if (!poe_mem(self, instr[1].A1, self->X)) {
+    op_TRAX(self);
+    return 2;
+  }
+  self->PC += 4;
+  return 3;
+}
+
+static int fus_CPXA_SUB_DESVNZ(cpu_t *self, instr_decod_t *instr)
+{
+  int mA1;
+  if (!pega_mem(self, instr[1].A1, &mA1)) {
+    op_CPXA(self);
+    return 2;
+  }
+  self->A = self->X - mA1;
+  self->PC = (self->A != 0) ? instr[2].A1 : self->PC + 5;
+  return 3;
+}
+
+static int fus_CPXA_RESTO_DESVNZ(cpu_t *self, instr_decod_t *instr)
+{
+  int mA1;
+  if (!pega_mem(self, instr[1].A1, &mA1)) {
+    op_CPXA(self);
+    return 2;
+  }
+  self->A = self->X % mA1;
+  self->PC = (self->A != 0) ? instr[2].A1 : self->PC + 5;
+  return 3;
+}
+
+static int fus_CARGM_SOMA_ARMM(cpu_t *self, instr_decod_t *instr)
+{
+  int mA1;
+  if (!pega_mem(self, instr[0].A1, &mA1)) return 1;
+  self->A = mA1;
+  self->PC += 2;
+  if (!pega_mem(self, instr[1].A1, &mA1)) return 2;
+  self->A += mA1;
+  self->PC += 2;
+  if (!poe_mem(self, instr[2].A1, self->A)) return 3;
+  self->PC += 2;
+  return 3;
+}
+
+static int fus_CARGM_TRAX(cpu_t *self, instr_decod_t *instr)
+{
+  int mA1;
+  if (!pega_mem(self, instr[0].A1, &mA1)) return 1;
+  self->A = self->X;
+  self->X = mA1;
+  self->PC += 3;
+  return 2;
+}
+
+static int fus_CARGI_TRAX(cpu_t *self, instr_decod_t *instr)
+{
+  self->A = self->X;
+  self->X = instr[0].A1;
+  self->PC += 3;
+  return 2;
+}
+
+static int fus_INCX_CPXA(cpu_t *self, instr_decod_t *instr)
+{
+  self->X += 1;
+  self->A = self->X;
+  self->PC += 2;
+  return 2;
+}
+
+// as superinstruções; as sequências maiores vêm antes, para serem
+//   preferidas na construção dos blocos
+static fusao_t fusoes[N_FUSOES] = {
+  [FUS_TRAX_ARMM_TRAX]    = { 3, { TRAX, ARMM, TRAX },    1, fus_TRAX_ARMM_TRAX },
+  [FUS_CPXA_SUB_DESVNZ]   = { 3, { CPXA, SUB, DESVNZ },  -1, fus_CPXA_SUB_DESVNZ },
+  [FUS_CPXA_RESTO_DESVNZ] = { 3, { CPXA, RESTO, DESVNZ },-1, fus_CPXA_RESTO_DESVNZ },
+  [FUS_CARGM_SOMA_ARMM]   = { 3, { CARGM, SOMA, ARMM },   2, fus_CARGM_SOMA_ARMM },
+  [FUS_CARGM_TRAX]        = { 2, { CARGM, TRAX },        -1, fus_CARGM_TRAX },
+  [FUS_CARGI_TRAX]        = { 2, { CARGI, TRAX },        -1, fus_CARGI_TRAX },
+  [FUS_INCX_CPXA]         = { 2, { INCX, CPXA },         -1, fus_INCX_CPXA },
+};
+
+// retorna a superinstrução que começa na instrução 'i' do bloco, ou NULL
+static fusao_t *cpu__procura_fusao(cpu_t *self, bloco_t *bloco, int i)
+{
+  for (int f = 0; f < N_FUSOES; f++) {
+    fusao_t *fusao = &fusoes[f];
+    if (i + fusao->n_instr > bloco->n_instr) continue;
+    bool casa = true;
+    for (int j = 0; j < fusao->n_instr; j++) {
+      if (bloco->instr[i + j].opcode != fusao->opcodes[j]) {
+        casa = false;
+        break;
+      }
+    }
+    if (!casa) continue;
+    // uma escrita antes do fim da sequência não pode alterar as instruções
+    //   seguintes, que já foram decodificadas (o SO não mapeia duas páginas
+    //   no mesmo quadro, então basta que o endereço esteja em outra página)
+    int e = fusao->escrita;
+    if (e >= 0 && e < fusao->n_instr - 1
+        && mmu_pagina(self->mmu, bloco->instr[i + e].A1) == bloco->pagina) {
+      continue;
+    }
+    return fusao;
+  }
+  return NULL;
+}
+
+// marca as superinstruções nas instruções do bloco
+static void cpu__funde_instrucoes(cpu_t *self, bloco_t *bloco)
+{
+  int i = 0;
+  while (i < bloco->n_instr) {
+    fusao_t *fusao = cpu__procura_fusao(self, bloco, i);
+    bloco->instr[i].fusao = fusao;
+    i += fusao != NULL ? fusao->n_instr : 1;
+  }
+}
+
+
+// ---------------------------------------------------------------------
+// PERFIL {{{1
 // ---------------------------------------------------------------------
 
-static void executa_a_instrucao(cpu_t *self, int opcode)
+// o perfil conta as sequências de instruções dentro dos blocos básicos (só
+//   elas podem ser fundidas em superinstruções)
+// para não custar nada por instrução, conta-se só o número de execuções de
+//   cada bloco, e as sequências dele são somadas no perfil quando o bloco é
+//   substituído no cache ou quando o perfil é consultado; um bloco
+//   interrompido no meio é contado como se tivesse sido executado inteiro
+
+// soma no perfil as sequências de instruções das execuções de 'bloco'
+static void cpu__contabiliza_bloco(cpu_t *self, bloco_t *bloco)
+{
+  long n = bloco->execucoes;
+  if (n == 0) return;
+  for (int i = 0; i + 1 < bloco->n_instr; i++) {
+    int op0 = bloco->instr[i].opcode;
+    int op1 = bloco->instr[i + 1].opcode;
+    self->perfil_pares[op0][op1] += n;
+    if (i + 2 < bloco->n_instr) {
+      int op2 = bloco->instr[i + 2].opcode;
+      self->perfil_trios[op0][op1][op2] += n;
+    }
+  }
+  bloco->execucoes = 0;
+}
+
+// o perfil por endereço (ver perfil.h) só existe se compilado com CPU_PERFIL
+// sem ele, as funções abaixo são vazias, e o compilador elimina as chamadas
+// as instruções são contadas ao sair de cada bloco (inclusive uma que causou
+//   erro, como no relógio), para não alterar o laço de execução
+
+// retorna o pid a usar no perfil para código executado no modo 'modo'
+static inline int cpu__perfil_pid(cpu_t *self, cpu_modo_t modo)
+{
+#ifdef CPU_PERFIL
+  return modo == supervisor ? PERFIL_PID_SO : self->pid;
+#else
+  return 0;
+#endif
+}
+
+// conta no perfil as primeiras 'n' instruções de 'bloco'
+static inline void cpu__perfil_bloco(cpu_t *self, bloco_t *bloco, int n)
+{
+#ifdef CPU_PERFIL
+  int pid = cpu__perfil_pid(self, bloco->modo);
+  int PC = bloco->PC;
+  for (int i = 0; i < n; i++) {
+    int opcode = bloco->instr[i].opcode;
+    perfil_conta_instrucao(self->perfil, pid, PC, opcode);
+    PC += 1 + instrucao_num_args(opcode);
+  }
+#endif
+}
+
+// conta no perfil a instrução fora de bloco 'instr', no PC
+static inline void cpu__perfil_avulsa(cpu_t *self, instr_decod_t *instr)
+{
+#ifdef CPU_PERFIL
+  if (instr == NULL) return;
+  perfil_conta_instrucao(self->perfil, cpu__perfil_pid(self, self->modo),
+                         self->PC, instr->opcode);
+#endif
+}
+
+// conta no perfil a falta de página causada pela instrução no PC, se for o caso
+static inline void cpu__perfil_falta(cpu_t *self)
+{
+#ifdef CPU_PERFIL
+  if (self->erro != ERR_PAG_AUSENTE) return;
+  perfil_conta_falta(self->perfil, cpu__perfil_pid(self, self->modo), self->PC);
+#endif
+}
+
+
+// ---------------------------------------------------------------------
+// DECODIFICAÇÃO {{{1
+// ---------------------------------------------------------------------
+
+static void op_invalida(cpu_t *self) // opcode desconhecido
+{
+  self->erro = ERR_INSTR_INV;
+}
+
+// a função que implementa cada instrução
+static cpu_op_t operacoes[N_OPCODE] = {
+  [NOP]    = op_NOP,
+  [PARA]   = op_PARA,
+  [CARGI]  = op_CARGI,
+  [CARGM]  = op_CARGM,
+  [CARGX]  = op_CARGX,
+  [ARMM]   = op_ARMM,
+  [ARMX]   = op_ARMX,
+  [TRAX]   = op_TRAX,
+  [CPXA]   = op_CPXA,
+  [INCX]   = op_INCX,
+  [SOMA]   = op_SOMA,
+  [SUB]    = op_SUB,
+  [MULT]   = op_MULT,
+  [DIV]    = op_DIV,
+  [RESTO]  = op_RESTO,
+  [NEG]    = op_NEG,
+  [DESV]   = op_DESV,
+  [DESVZ]  = op_DESVZ,
+  [DESVNZ] = op_DESVNZ,
+  [DESVN]  = op_DESVN,
+  [DESVP]  = op_DESVP,
+  [CHAMA]  = op_CHAMA,
+  [RET]    = op_RET,
+  [LE]     = op_LE,
+  [ESCR]   = op_ESCR,
+  [RETI]   = op_RETI,
+  [CHAMAC] = op_CHAMAC,
+  [CHAMAS] = op_CHAMAS,
+};
+
+// preenche 'instr' com a decodificação de 'opcode' (sem o argumento)
+static void cpu__decodifica_opcode(int opcode, instr_decod_t *instr)
+{
+  instr->opcode = opcode;
+  instr->tem_A1 = false;
+  instr->fusao = NULL;
+#ifdef CPU_NUCLEO_DIRETO
+  instr->rotulo = NULL;
+#endif
+  if (opcode >= 0 && opcode < N_OPCODE && operacoes[opcode] != NULL) {
+    instr->executa = operacoes[opcode];
+    // CHAMAC executa o SO, que acessa os dispositivos
+    instr->es = opcode == LE || opcode == ESCR || opcode == CHAMAC;
+    instr->escreve = opcode == ARMM || opcode == ARMX || opcode == CHAMA;
+  } else {
+    instr->executa = op_invalida;
+    instr->es = false;
+    instr->escreve = false;
+  }
+}
+
+// retorna true se a instrução 'opcode' termina um bloco básico
+static bool cpu__termina_bloco(int opcode)
 {
   switch (opcode) {
-    case NOP:    op_NOP(self);    break;
-    case PARA:   op_PARA(self);   break;
-    case CARGI:  op_CARGI(self);  break;
-    case CARGM:  op_CARGM(self);  break;
-    case CARGX:  op_CARGX(self);  break;
-    case ARMM:   op_ARMM(self);   break;
-    case ARMX:   op_ARMX(self);   break;
-    case TRAX:   op_TRAX(self);   break;
-    case CPXA:   op_CPXA(self);   break;
-    case INCX:   op_INCX(self);   break;
-    case SOMA:   op_SOMA(self);   break;
-    case SUB:    op_SUB(self);    break;
-    case MULT:   op_MULT(self);   break;
-    case DIV:    op_DIV(self);    break;
-    case RESTO:  op_RESTO(self);  break;
-    case NEG:    op_NEG(self);    break;
-    case DESV:   op_DESV(self);   break;
-    case DESVZ:  op_DESVZ(self);  break;
-    case DESVNZ: op_DESVNZ(self); break;
-    case DESVN:  op_DESVN(self);  break;
-    case DESVP:  op_DESVP(self);  break;
-    case CHAMA:  op_CHAMA(self);  break;
-    case RET:    op_RET(self);    break;
-    case LE:     op_LE(self);     break;
-    case ESCR:   op_ESCR(self);   break;
-    case RETI:   op_RETI(self);   break;
-    case CHAMAC: op_CHAMAC(self); break;
-    case CHAMAS: op_CHAMAS(self); break;
-    default:     self->erro = ERR_INSTR_INV;
+    case PARA:
+    case DESV:
+    case DESVZ:
+    case DESVNZ:
+    case DESVN:
+    case DESVP:
+    case CHAMA:
+    case RET:
+    case LE:
+    case ESCR:
+    case CHAMAS:
+    case RETI:
+    case CHAMAC:
+      return true;
+    default:
+      return false;
   }
 }
 
-void cpu_executa_1(cpu_t *self)
+// retorna true se 'bloco' é o bloco que começa em 'PC' no espaço de
+//   endereçamento 'tabpag' no modo atual da CPU, e ainda é válido
+static bool cpu__bloco_valido(cpu_t *self, bloco_t *bloco, tabpag_t *tabpag, int PC)
 {
-  // não executa se CPU já estiver em erro
-  if (self->erro != ERR_OK) return;
+  if (!bloco->valido || bloco->PC != PC || bloco->tabpag != tabpag
+      || bloco->modo != self->modo) {
+    return false;
+  }
+  if (tabpag != NULL && bloco->versao_tabpag != tabpag_versao(tabpag)) {
+    return false;
+  }
+  return bloco->versao_quadro == mmu_versao_quadro(self->mmu, bloco->quadro);
+}
+
+// constrói em 'bloco' o bloco básico que começa no PC
+// as instruções são lidas pela MMU sem alterar o estado da CPU; o bloco
+//   termina antes de uma instrução que não possa ser lida ou executada,
+//   que será executada depois sem bloco, e causará o erro correspondente
+// uma instrução que acessa dispositivos sempre começa um bloco
+// retorna NULL se não for possível colocar nem a primeira instrução no bloco
+static bloco_t *cpu__constroi_bloco(cpu_t *self, tabpag_t *tabpag, bloco_t *bloco)
+{
+  cpu__contabiliza_bloco(self, bloco);
+  bloco->valido = false;
+  int endfis;
+  if (mmu_traduz(self->mmu, self->PC, &endfis, self->modo) != ERR_OK) {
+    return NULL;
+  }
+  bloco->tabpag = tabpag;
+  bloco->modo = self->modo;
+  bloco->PC = self->PC;
+  bloco->quadro = mmu_pagina(self->mmu, endfis);
+  bloco->pagina = mmu_pagina(self->mmu, self->PC);
+  bloco->n_instr = 0;
+
+  int PC = self->PC;
+  int PC_desvio = -1;
+  while (bloco->n_instr < CPU_MAX_INSTR_BLOCO && mmu_pagina(self->mmu, PC) == bloco->pagina) {
+    int opcode;
+    if (mmu_le(self->mmu, PC, &opcode, self->modo) != ERR_OK) break;
+    instr_decod_t *instr = &bloco->instr[bloco->n_instr];
+    cpu__decodifica_opcode(opcode, instr);
+    if (instr->executa == op_invalida) break;
+    if (self->modo != supervisor && self->privilegiadas[opcode]) break;
+    if (instr->es && bloco->n_instr > 0) break;
+    if (instrucao_num_args(opcode) > 0) {
+      // um argumento em outra página é lido só na execução, para não causar
+      //   uma falta de página que a execução não causaria (um desvio
+      //   condicional não tomado não lê o argumento)
+      if (mmu_pagina(self->mmu, PC + 1) != bloco->pagina) break;
+      if (mmu_le(self->mmu, PC + 1, &instr->A1, self->modo) != ERR_OK) break;
+      instr->tem_A1 = true;
+    }
+    bloco->n_instr++;
+    PC += 1 + instrucao_num_args(opcode);
+    if (cpu__termina_bloco(opcode)) {
+      if (opcode >= DESV && opcode <= DESVP) PC_desvio = instr->A1;
+      if (opcode == CHAMA) PC_desvio = instr->A1 + 1;
+      // depois destas a execução não continua na instrução seguinte
+      if (opcode == DESV || opcode == CHAMA || opcode == RET || opcode == RETI) {
+        PC = -1;
+      }
+      break;
+    }
+  }
+  if (bloco->n_instr == 0) return NULL;
+  cpu__funde_instrucoes(self, bloco);
+
+  bloco->PC_saida[0] = PC;
+  bloco->PC_saida[1] = PC_desvio;
+  bloco->saida[0] = NULL;
+  bloco->saida[1] = NULL;
+  if (tabpag != NULL) bloco->versao_tabpag = tabpag_versao(tabpag);
+  bloco->versao_quadro = mmu_versao_quadro(self->mmu, bloco->quadro);
+  bloco->valido = true;
+  return bloco;
+}
+
+// obtém o bloco básico que começa em 'PC' (que deve ser o PC da CPU)
+// 'anterior' é o bloco que acabou de ser executado (ou NULL); se a execução
+//   continuou em uma das saídas dele, usa o bloco encadeado, sem procurar
+//   no cache, e encadeia o bloco encontrado
+// retorna NULL se a instrução no PC não puder ser colocada em um bloco
+static bloco_t *cpu__pega_bloco(cpu_t *self, bloco_t *anterior, int PC)
+{
+  // em modo supervisor a MMU não traduz endereços
+  tabpag_t *tabpag = self->modo == supervisor ? NULL : mmu_tabpag(self->mmu);
+  bloco_t *bloco = NULL;
+  int saida = -1;
+  if (anterior != NULL) {
+    if (anterior->PC_saida[0] == PC) saida = 0;
+    else if (anterior->PC_saida[1] == PC) saida = 1;
+    if (saida != -1) bloco = anterior->saida[saida];
+  }
+  if (bloco == NULL || !cpu__bloco_valido(self, bloco, tabpag, PC)) {
+    bloco = &self->blocos[PC & (CPU_TAM_CACHE - 1)];
+    if (!cpu__bloco_valido(self, bloco, tabpag, PC)) {
+      bloco = cpu__constroi_bloco(self, tabpag, bloco);
+    }
+    if (saida != -1) anterior->saida[saida] = bloco;
+  }
+  if (bloco == NULL) return NULL;
+  // a leitura das instruções pela MMU teria marcado o acesso à página (e
+  //   registrado a referência no traço)
+  if (tabpag != NULL) {
+    tabpag_marca_bit_acesso(tabpag, bloco->pagina, false);
+    mmu_registra_referencia(self->mmu, bloco->pagina);
+  }
+  bloco->execucoes++;
+  return bloco;
+}
+
+// retorna true se o quadro das instruções do bloco foi alterado depois que
+//   ele foi construído (as instruções seguintes podem não valer mais)
+static bool cpu__bloco_alterado(cpu_t *self, bloco_t *bloco)
+{
+  return bloco->versao_quadro != mmu_versao_quadro(self->mmu, bloco->quadro);
+}
 
+// lê e decodifica a instrução no PC sem colocá-la em um bloco, acessando a
+//   memória como se não houvesse cache (o argumento é lido na execução)
+// retorna NULL se a instrução não puder ser executada, com o motivo em erro
+static instr_decod_t *cpu__decodifica_avulsa(cpu_t *self)
+{
   int opcode;
-  if (pega_opcode(self, &opcode)) {
-    executa_a_instrucao(self, opcode);
+  // não pode executar se houver erro na leitura da memória
+  if (!pega_mem(self, self->PC, &opcode)) return NULL;
+  cpu__decodifica_opcode(opcode, &self->instr_avulsa);
+  // não pode executar instrução privilegiada em modo usuário
+  if (self->modo != supervisor && self->instr_avulsa.executa != op_invalida
+      && self->privilegiadas[opcode]) {
+    self->erro = ERR_INSTR_PRIV;
+    return NULL;
+  }
+  return &self->instr_avulsa;
+}
+
+
+// ---------------------------------------------------------------------
+// EXECUÇÃO DE INSTRUÇÕES {{{1
+// ---------------------------------------------------------------------
+
+// executa a instrução 'instr'
+// 'instr' é NULL se a instrução não pôde ser obtida (a CPU está em erro)
+static void cpu__executa(cpu_t *self, instr_decod_t *instr)
+{
+  if (instr != NULL) {
+    self->instr = instr;
+    instr->executa(self);
   }
 
   // se a CPU entrou em erro, causa uma interrupção
@@ -502,11 +1036,439 @@ void cpu_executa_1(cpu_t *self)
   //   o SO dizer que não tem mais nada para fazer, e deve-se deixar a CPU dormindo
   //   até que venha uma interrupção de E/S
   if (self->erro != ERR_OK && self->erro != ERR_CPU_PARADA) {
+    cpu__perfil_falta(self);
     // se a interrupção não é aceita nesse ponto, temos um problema grave...
     assert(cpu_interrompe(self, IRQ_ERR_CPU));
   }
 }
 
+void cpu_executa_1(cpu_t *self)
+{
+  cpu_executa_n(self, 1);
+}
+
+#ifndef CPU_NUCLEO_DIRETO
+
+// executa a superinstrução que começa em 'instr', que tem que caber no lote
+// retorna o número de instruções executadas
+static int cpu__executa_fusao(cpu_t *self, instr_decod_t *instr)
+{
+  fusao_t *fusao = instr->fusao;
+  self->instr = instr;
+  int executadas = fusao->executa(self, instr);
+  if (self->erro == ERR_OK) {
+    self->fusoes_executadas[fusao - fusoes]++;
+  } else {
+    // causa a interrupção de erro
+    cpu__executa(self, NULL);
+  }
+  return executadas;
+}
+
+int cpu_executa_n(cpu_t *self, int n)
+{
+  cpu_modo_t modo = self->modo;
+  int executadas = 0;
+  bloco_t *bloco = NULL;
+  // não executa se CPU já estiver em erro
+  while (executadas < n && self->erro == ERR_OK) {
+    bloco = cpu__pega_bloco(self, bloco, self->PC);
+    if (bloco == NULL) {
+      instr_decod_t *instr = cpu__decodifica_avulsa(self);
+      bool es = instr != NULL && instr->es;
+      // uma instrução de E/S só é executada no início do lote, para que veja o
+      //   relógio e os dispositivos atualizados pelo controlador
+      if (es && executadas > 0) break;
+      cpu__perfil_avulsa(self, instr);
+      cpu__executa(self, instr);
+      executadas++;
+      // termina o lote depois de E/S, PARA, interrupção ou retorno de interrupção
+      if (es || self->erro != ERR_OK || self->modo != modo) break;
+      continue;
+    }
+    // só a primeira instrução de um bloco pode ser de E/S
+    if (bloco->instr[0].es && executadas > 0) break;
+    int i = 0;
+    bool termina = false;
+    bool alterado = false;
+    while (i < bloco->n_instr) {
+      if (executadas == n) {
+        termina = true;
+        break;
+      }
+      instr_decod_t *instr = &bloco->instr[i];
+      fusao_t *fusao = instr->fusao;
+      bool escreve;
+      if (fusao != NULL && executadas + fusao->n_instr <= n) {
+        int k = cpu__executa_fusao(self, instr);
+        executadas += k;
+        i += k;
+        escreve = fusao->escrita >= 0;
+      } else {
+        cpu__executa(self, instr);
+        executadas++;
+        i++;
+        escreve = instr->escreve;
+      }
+      if (instr->es || self->erro != ERR_OK || self->modo != modo) {
+        termina = true;
+        break;
+      }
+      // se o bloco alterou a si mesmo, o resto dele tem que ser relido
+      if (escreve && cpu__bloco_alterado(self, bloco)) {
+        alterado = true;
+        break;
+      }
+    }
+    cpu__perfil_bloco(self, bloco, i);
+    if (termina) break;
+    if (alterado) bloco = NULL;
+  }
+  return executadas;
+}
+
+#else // CPU_NUCLEO_DIRETO
+
+
+// ---------------------------------------------------------------------
+// EXECUÇÃO COM DESPACHO DIRETO {{{1
+// ---------------------------------------------------------------------
+
+// núcleo alternativo do interpretador, escolhido na compilação (ver Makefile)
+// usa a extensão do gcc que permite obter o endereço de um rótulo e desviar
+//   para ele ("computed goto"): cada instrução de um bloco guarda o endereço
+//   do código que a executa, e o código de cada instrução termina desviando
+//   direto para o da instrução seguinte do bloco, sem chamada de função nem
+//   switch; a marca no final do bloco desvia para a busca do próximo bloco
+// PC, A e X ficam em variáveis locais durante o lote, e são copiados para a
+//   CPU antes de qualquer coisa que possa usá-los (funções op_*, interrupção)
+// tem o mesmo comportamento de cpu_executa_n no núcleo com funções
+
+int cpu_executa_n(cpu_t *self, int n)
+{
+  // o código para cada opcode; os não listados usam as funções op_*
+  static void *rotulos[N_OPCODE] = {
+    [NOP]    = &&l_NOP,
+    [CARGI]  = &&l_CARGI,
+    [CARGM]  = &&l_CARGM,
+    [CARGX]  = &&l_CARGX,
+    [ARMM]   = &&l_ARMM,
+    [ARMX]   = &&l_ARMX,
+    [TRAX]   = &&l_TRAX,
+    [CPXA]   = &&l_CPXA,
+    [INCX]   = &&l_INCX,
+    [SOMA]   = &&l_SOMA,
+    [SUB]    = &&l_SUB,
+    [MULT]   = &&l_MULT,
+    [DIV]    = &&l_DIV,
+    [RESTO]  = &&l_RESTO,
+    [NEG]    = &&l_NEG,
+    [DESV]   = &&l_DESV,
+    [DESVZ]  = &&l_DESVZ,
+    [DESVNZ] = &&l_DESVNZ,
+    [DESVN]  = &&l_DESVN,
+    [DESVP]  = &&l_DESVP,
+    [CHAMA]  = &&l_CHAMA,
+    [RET]    = &&l_RET,
+  };
+  // o código para cada superinstrução
+  static void *rotulos_fusao[N_FUSOES] = {
+    [FUS_TRAX_ARMM_TRAX]    = &&lf_TRAX_ARMM_TRAX,
+    [FUS_CPXA_SUB_DESVNZ]   = &&lf_CPXA_SUB_DESVNZ,
+    [FUS_CPXA_RESTO_DESVNZ] = &&lf_CPXA_RESTO_DESVNZ,
+    [FUS_CARGM_SOMA_ARMM]   = &&lf_CARGM_SOMA_ARMM,
+    [FUS_CARGM_TRAX]        = &&lf_CARGM_TRAX,
+    [FUS_CARGI_TRAX]        = &&lf_CARGI_TRAX,
+    [FUS_INCX_CPXA]         = &&lf_INCX_CPXA,
+  };
+
+  // não executa se CPU já estiver em erro
+  if (self->erro != ERR_OK || n <= 0) return 0;
+
+  cpu_modo_t modo = self->modo;
+  int PC = self->PC;
+  int A = self->A;
+  int X = self->X;
+  int executadas = 0;
+  bloco_t *bloco = NULL;
+  instr_decod_t *instr;
+  int mA1;
+
+#define SALVA_REGISTRADORES() (self->PC = PC, self->A = A, self->X = X)
+#define RECUPERA_REGISTRADORES() (PC = self->PC, A = self->A, X = self->X)
+// sai do bloco antes da instrução 'prox' (para o perfil)
+#define SAI_DO_BLOCO(prox) cpu__perfil_bloco(self, bloco, (prox) - bloco->instr)
+// erro na instrução 'j' de uma superinstrução, depois de executar as anteriores
+#define ERRO_NA_FUSAO(j) do {                \
+    instr += j;                              \
+    executadas += j;                         \
+    goto erro;                               \
+  } while (0)
+// passa para a próxima instrução do bloco
+#define PROXIMA() do {                       \
+    instr++;                                 \
+    if (++executadas == n) goto fim;         \
+    goto *instr->rotulo;                     \
+  } while (0)
+// idem, depois de uma escrita na memória, que pode ter alterado o bloco
+#define PROXIMA_DEPOIS_DE_ESCRITA() do {     \
+    if (cpu__bloco_alterado(self, bloco)) {  \
+      SAI_DO_BLOCO(instr + 1);               \
+      bloco = NULL;                          \
+      if (++executadas == n) goto fim;       \
+      goto proximo_bloco;                    \
+    }                                        \
+    PROXIMA();                               \
+  } while (0)
+// início de uma superinstrução: se não cabe no lote, executa só a primeira
+//   instrução (todas as superinstruções começam com instruções com rótulo)
+#define INICIO_FUSAO(f) do {                 \
+    if (executadas + fusoes[f].n_instr > n) { \
+      goto *rotulos[instr->opcode];          \
+    }                                        \
+  } while (0)
+// fim de uma superinstrução: a próxima é a última da sequência
+#define FIM_FUSAO(f) do {                    \
+    self->fusoes_executadas[f]++;            \
+    instr += fusoes[f].n_instr - 1;          \
+    executadas += fusoes[f].n_instr - 1;     \
+  } while (0)
+
+proximo_bloco:
+  self->PC = PC;
+  bloco = cpu__pega_bloco(self, bloco, PC);
+  if (bloco == NULL) {
+    // instrução fora de bloco, executada pela função
+    SALVA_REGISTRADORES();
+    instr = cpu__decodifica_avulsa(self);
+    bool es = instr != NULL && instr->es;
+    if (es && executadas > 0) return executadas;
+    cpu__perfil_avulsa(self, instr);
+    cpu__executa(self, instr);
+    executadas++;
+    if (es || self->erro != ERR_OK || self->modo != modo) return executadas;
+    RECUPERA_REGISTRADORES();
+    if (executadas == n) goto fim;
+    goto proximo_bloco;
+  }
+  instr = bloco->instr;
+  // só a primeira instrução de um bloco pode ser de E/S
+  if (instr->es && executadas > 0) goto fim;
+  if (instr->rotulo == NULL) {
+    // primeira execução do bloco
+    for (int i = 0; i < bloco->n_instr; i++) {
+      fusao_t *fusao = bloco->instr[i].fusao;
+      void *rotulo = fusao != NULL ? rotulos_fusao[fusao - fusoes]
+                                   : rotulos[bloco->instr[i].opcode];
+      bloco->instr[i].rotulo = rotulo != NULL ? rotulo : &&l_funcao;
+    }
+    bloco->instr[bloco->n_instr].rotulo = &&l_fim_bloco;
+  }
+  goto *instr->rotulo;
+
+l_NOP:
+  PC += 1;
+  PROXIMA();
+l_CARGI:
+  A = instr->A1;
+  PC += 2;
+  PROXIMA();
+l_CARGM:
+  if (!pega_mem(self, instr->A1, &mA1)) goto erro;
+  A = mA1;
+  PC += 2;
+  PROXIMA();
+l_CARGX:
+  if (!pega_mem(self, instr->A1 + X, &mA1)) goto erro;
+  A = mA1;
+  PC += 2;
+  PROXIMA();
+l_ARMM:
+  if (!poe_mem(self, instr->A1, A)) goto erro;
+  PC += 2;
+  PROXIMA_DEPOIS_DE_ESCRITA();
+l_ARMX:
+  if (!poe_mem(self, instr->A1 + X, A)) goto erro;
+  PC += 2;
+  PROXIMA_DEPOIS_DE_ESCRITA();
+l_TRAX:
+  mA1 = A;
+  A = X;
+  X = mA1;
+  PC += 1;
+  PROXIMA();
+l_CPXA:
+  A = X;
+  PC += 1;
+  PROXIMA();
+l_INCX:
+  X += 1;
+  PC += 1;
+  PROXIMA();
+l_SOMA:
+  if (!pega_mem(self, instr->A1, &mA1)) goto erro;
+  A += mA1;
+  PC += 2;
+  PROXIMA();
+l_SUB:
+  if (!pega_mem(self, instr->A1, &mA1)) goto erro;
+  A -= mA1;
+  PC += 2;
+  PROXIMA();
+l_MULT:
+  if (!pega_mem(self, instr->A1, &mA1)) goto erro;
+  A *= mA1;
+  PC += 2;
+  PROXIMA();
+l_DIV:
+  if (!pega_mem(self, instr->A1, &mA1)) goto erro;
+  A /= mA1;
+  PC += 2;
+  PROXIMA();
+l_RESTO:
+  if (!pega_mem(self, instr->A1, &mA1)) goto erro;
+  A %= mA1;
+  PC += 2;
+  PROXIMA();
+l_NEG:
+  A = -A;
+  PC += 1;
+  PROXIMA();
+l_DESV:
+  PC = instr->A1;
+  PROXIMA();
+l_DESVZ:
+  PC = (A == 0) ? instr->A1 : PC + 2;
+  PROXIMA();
+l_DESVNZ:
+  PC = (A != 0) ? instr->A1 : PC + 2;
+  PROXIMA();
+l_DESVN:
+  PC = (A < 0) ? instr->A1 : PC + 2;
+  PROXIMA();
+l_DESVP:
+  PC = (A > 0) ? instr->A1 : PC + 2;
+  PROXIMA();
+l_CHAMA:
+  if (!poe_mem(self, instr->A1, PC + 2)) goto erro;
+  PC = instr->A1 + 1;
+  PROXIMA();
+l_RET:
+  if (!pega_mem(self, instr->A1, &mA1)) goto erro;
+  PC = mA1;
+  PROXIMA();
+
+// superinstruções; em caso de erro, conta as instruções anteriores da sequência
+lf_TRAX_ARMM_TRAX:
+  INICIO_FUSAO(FUS_TRAX_ARMM_TRAX);
+  if (!poe_mem(self, instr[1].A1, X)) {
+    mA1 = A;
+    A = X;
+    X = mA1;
+    PC += 1;
+    ERRO_NA_FUSAO(1);
+  }
+  PC += 4;
+  FIM_FUSAO(FUS_TRAX_ARMM_TRAX);
+  PROXIMA_DEPOIS_DE_ESCRITA();
+lf_CPXA_SUB_DESVNZ:
+  INICIO_FUSAO(FUS_CPXA_SUB_DESVNZ);
+  if (!pega_mem(self, instr[1].A1, &mA1)) {
+    A = X;
+    PC += 1;
+    ERRO_NA_FUSAO(1);
+  }
+  A = X - mA1;
+  PC = (A != 0) ? instr[2].A1 : PC + 5;
+  FIM_FUSAO(FUS_CPXA_SUB_DESVNZ);
+  PROXIMA();
+lf_CPXA_RESTO_DESVNZ:
+  INICIO_FUSAO(FUS_CPXA_RESTO_DESVNZ);
+  if (!pega_mem(self, instr[1].A1, &mA1)) {
+    A = X;
+    PC += 1;
+    ERRO_NA_FUSAO(1);
+  }
+  A = X % mA1;
+  PC = (A != 0) ? instr[2].A1 : PC + 5;
+  FIM_FUSAO(FUS_CPXA_RESTO_DESVNZ);
+  PROXIMA();
+lf_CARGM_SOMA_ARMM:
+  INICIO_FUSAO(FUS_CARGM_SOMA_ARMM);
+  if (!pega_mem(self, instr[0].A1, &mA1)) goto erro;
+  A = mA1;
+  PC += 2;
+  if (!pega_mem(self, instr[1].A1, &mA1)) ERRO_NA_FUSAO(1);
+  A += mA1;
+  PC += 2;
+  if (!poe_mem(self, instr[2].A1, A)) ERRO_NA_FUSAO(2);
+  PC += 2;
+  FIM_FUSAO(FUS_CARGM_SOMA_ARMM);
+  PROXIMA_DEPOIS_DE_ESCRITA();
+lf_CARGM_TRAX:
+  INICIO_FUSAO(FUS_CARGM_TRAX);
+  if (!pega_mem(self, instr[0].A1, &mA1)) goto erro;
+  A = X;
+  X = mA1;
+  PC += 3;
+  FIM_FUSAO(FUS_CARGM_TRAX);
+  PROXIMA();
+lf_CARGI_TRAX:
+  INICIO_FUSAO(FUS_CARGI_TRAX);
+  A = X;
+  X = instr[0].A1;
+  PC += 3;
+  FIM_FUSAO(FUS_CARGI_TRAX);
+  PROXIMA();
+lf_INCX_CPXA:
+  INICIO_FUSAO(FUS_INCX_CPXA);
+  X += 1;
+  A = X;
+  PC += 2;
+  FIM_FUSAO(FUS_INCX_CPXA);
+  PROXIMA();
+
+l_funcao:
+  // instruções que podem alterar o modo, parar a CPU ou acessar dispositivos
+  //   são executadas pela função
+  SALVA_REGISTRADORES();
+  cpu__executa(self, instr);
+  if (instr->es || self->erro != ERR_OK || self->modo != modo) {
+    SAI_DO_BLOCO(instr + 1);
+    return executadas + 1;
+  }
+  RECUPERA_REGISTRADORES();
+  PROXIMA();
+
+l_fim_bloco:
+  SAI_DO_BLOCO(instr);
+  goto proximo_bloco;
+
+erro:
+  // a instrução causou erro; o PC ainda aponta para ela
+  executadas++;
+  SAI_DO_BLOCO(instr + 1);
+  SALVA_REGISTRADORES();
+  cpu__executa(self, NULL);
+  return executadas;
+
+fim:
+  if (bloco != NULL) SAI_DO_BLOCO(instr);
+  SALVA_REGISTRADORES();
+  return executadas;
+
+#undef SALVA_REGISTRADORES
+#undef RECUPERA_REGISTRADORES
+#undef SAI_DO_BLOCO
+#undef ERRO_NA_FUSAO
+#undef PROXIMA
+#undef PROXIMA_DEPOIS_DE_ESCRITA
+#undef INICIO_FUSAO
+#undef FIM_FUSAO
+}
+
+#endif // CPU_NUCLEO_DIRETO
+
 
 // ---------------------------------------------------------------------
 // INTERRUPÇÃO {{{1
@@ -574,4 +1536,103 @@ static void cpu_desinterrompe(cpu_t *self)
   self->modo        = usuario;
 }
 
+
+// ---------------------------------------------------------------------
+// SNAPSHOT {{{1
+// ---------------------------------------------------------------------
+
+void cpu_snapshot(cpu_t *self, snapshot_t *snap)
+{
+  int erro = self->erro;
+  int modo = self->modo;
+  snapshot_int(snap, &self->PC);
+  snapshot_int(snap, &self->A);
+  snapshot_int(snap, &self->X);
+  snapshot_int(snap, &erro);
+  snapshot_int(snap, &self->complemento);
+  snapshot_int(snap, &modo);
+  if (!snapshot_carregando(snap)) return;
+  self->erro = erro;
+  self->modo = modo == usuario ? usuario : supervisor;
+
+  // os blocos no cache foram construídos a partir da memória e das tabelas
+  //   de páginas antigas; antes de esvaziar, soma as execuções no perfil
+  for (int i = 0; i < CPU_TAM_CACHE; i++) {
+    cpu__contabiliza_bloco(self, &self->blocos[i]);
+  }
+  memset(self->blocos, 0, sizeof(self->blocos));
+  self->instr = &self->instr_avulsa;
+}
+
+
+// ---------------------------------------------------------------------
+// RELATÓRIO {{{1
+// ---------------------------------------------------------------------
+
+// imprime na console as 'CPU_N_PERFIL' sequências de 'tam' instruções mais
+//   executadas, com contagens em 'cont' (vetor com CPU_N_INSTR^tam posições)
+static void cpu__imprime_mais_executadas(long *cont, int tam)
+{
+  int n = 1;
+  for (int i = 0; i < tam; i++) n *= CPU_N_INSTR;
+  // seleciona as maiores, uma por vez; a tabela é pequena
+  bool impressa[n];
+  memset(impressa, 0, sizeof(impressa));
+  for (int k = 0; k < CPU_N_PERFIL; k++) {
+    int maior = -1;
+    for (int i = 0; i < n; i++) {
+      if (!impressa[i] && cont[i] > 0 && (maior == -1 || cont[i] > cont[maior])) {
+        maior = i;
+      }
+    }
+    if (maior == -1) break;
+    impressa[maior] = true;
+    char seq[50] = "";
+    for (int i = tam - 1, div = n / CPU_N_INSTR; i >= 0; i--, div /= CPU_N_INSTR) {
+      strcat(seq, " ");
+      strcat(seq, instrucao_nome((maior / div) % CPU_N_INSTR));
+    }
+    console_printf("    >%-24s %ld vezes", seq, cont[maior]);
+  }
+}
+
+void cpu_gera_relatorio(cpu_t *self, char *arq_perfil)
+{
+  // soma no perfil os blocos que ainda estão no cache
+  for (int i = 0; i < CPU_TAM_CACHE; i++) {
+    cpu__contabiliza_bloco(self, &self->blocos[i]);
+  }
+
+  console_printf("\n--- RELATORIO DA CPU ---");
+  console_printf("\n[Pares de instrucoes mais executados]");
+  cpu__imprime_mais_executadas(&self->perfil_pares[0][0], 2);
+  console_printf("\n[Trios de instrucoes mais executados]");
+  cpu__imprime_mais_executadas(&self->perfil_trios[0][0][0], 3);
+
+  console_printf("\n[Superinstrucoes]");
+  long total = 0;
+  for (int f = 0; f < N_FUSOES; f++) {
+    fusao_t *fusao = &fusoes[f];
+    char seq[50] = "";
+    for (int j = 0; j < fusao->n_instr; j++) {
+      strcat(seq, " ");
+      strcat(seq, instrucao_nome(fusao->opcodes[j]));
+    }
+    // cada execução economiza o despacho das instruções depois da primeira
+    long poupados = self->fusoes_executadas[f] * (fusao->n_instr - 1);
+    console_printf("    >%-24s %ld vezes, %ld despachos poupados",
+                   seq, self->fusoes_executadas[f], poupados);
+    total += poupados;
+  }
+  console_printf("  - Total de despachos poupados: %ld", total);
+
+#ifdef CPU_PERFIL
+  if (perfil_grava(self->perfil, arq_perfil)) {
+    console_printf("\nPerfil de execucao gravado em '%s'", arq_perfil);
+  } else {
+    console_printf("\nNao foi possivel gravar o perfil de execucao");
+  }
+#endif
+}
+
 // vim: foldmethod=marker
@@ -8,6 +8,11 @@
 
 typedef struct cpu_t cpu_t; // tipo opaco
 
+// número máximo de CPUs em uma máquina
+// as CPUs compartilham a memória e o controlador de E/S, e cada uma tem
+//   a sua MMU
+#define MAX_CPUS 8
+
 // os modos de execução da CPU
 typedef enum { supervisor, usuario } cpu_modo_t;
 
@@ -19,6 +24,11 @@ typedef enum { supervisor, usuario } cpu_modo_t;
 #define CPU_END_erro        52
 #define CPU_END_complemento 53
 
+// o final da área de salvamento da CPU; além dos registradores acima, o
+//   tratador de interrupção guarda X no último endereço
+// a área é própria de cada CPU (ver mmu.h)
+#define CPU_END_FIM_SALVAMENTO 59
+
 // endereço inicial do PC quando o processador é inicializado
 #define CPU_END_RESET        0
 
@@ -33,6 +43,7 @@ typedef enum { supervisor, usuario } cpu_modo_t;
 #include "es.h"
 #include "irq.h"
 #include "mmu.h"
+#include "snapshot.h"
 
 // tipo da função a ser chamada quando executar a instrução CHAMAC
 typedef int (*func_chamaC_t)(void *argC, int reg_A);
@@ -45,12 +56,28 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es);
 // destrói a unidade de execução
 void cpu_destroi(cpu_t *self);
 
+// coloca a CPU parada, esperando uma interrupção, em vez de executar o
+//   código de reset
+// usado para as CPUs além da primeira, que só começam a executar quando
+//   recebem a primeira interrupção (e aí executam o tratador)
+void cpu_dorme(cpu_t *self);
+
 // executa a instrução apontada pelo PC
 //   se a CPU estiver em erro, não executa
 //   se a execução causar algum erro, altera o estado da CPU
 //     e causa uma interrupção
 void cpu_executa_1(cpu_t *self);
 
+// executa até 'n' instruções, como se fossem várias chamadas a cpu_executa_1
+// para antes de completar as 'n' se a CPU for interrompida, retornar de
+//   interrupção, entrar em erro ou parar (instrução PARA), ou se executar uma
+//   instrução que acessa dispositivos (LE, ESCR, CHAMAC) -- essas são sempre
+//   executadas sozinhas, e o controlador deve atualizar os dispositivos
+//   antes de cada chamada
+// retorna o número de instruções executadas (inclusive a que causou erro);
+//   retorna 0 se a CPU já estava em erro ou parada
+int cpu_executa_n(cpu_t *self, int n);
+
 // implementa uma interrupção
 // passa para modo supervisor, salva o estado da CPU no início da memória,
 //   altera A para identificar a requisição de interrupção, altera PC para
@@ -62,7 +89,22 @@ bool cpu_interrompe(cpu_t *self, irq_t irq);
 // e o argumento a passar para ela (normalmente, um ponteiro para o SO)
 void cpu_define_chamaC(cpu_t *self, func_chamaC_t func, void *argC);
 
+// informa o processo que será executado em modo usuário e o nome do arquivo
+//   do programa dele; só é usado pelo perfil de execução (ver perfil.h), se
+//   a CPU for compilada com ele
+void cpu_define_processo(cpu_t *self, int pid, char *nome_prog);
+
 // concatena a descrição do estado da CPU no final de str
 void cpu_concatena_descricao(cpu_t *self, char *str);
 
+// salva ou carrega os registradores e o estado interno da CPU (ver snapshot.h)
+// ao carregar, esvazia o cache de blocos
+void cpu_snapshot(cpu_t *self, snapshot_t *snap);
+
+// imprime na console o relatório da execução: as sequências de instruções
+//   mais executadas e o uso das superinstruções
+// se a CPU foi compilada com o perfil de execução, grava o perfil no arquivo
+//   'arq_perfil'
+void cpu_gera_relatorio(cpu_t *self, char *arq_perfil);
+
 #endif // CPU_H
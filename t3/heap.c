@@ -0,0 +1,157 @@
+// heap.c
+// fila de prioridade (heap de mínimo) indexada
+// simulador de computador
+// so25b
+
+#include "heap.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+struct heap_t {
+  int n;          // itens podem ser de 0 a n-1
+  int n_itens;    // quantos itens estão no heap
+  int *item;      // item[i] é o item na posição i do heap
+  long *chave;    // chave[it] é a chave do item it
+  int *posicao;   // posicao[it] é a posição do item it no heap, -1 se não está
+};
+
+heap_t *heap_cria(int n)
+{
+  heap_t *self = malloc(sizeof(*self));
+  assert(self != NULL);
+  self->n = n;
+  self->n_itens = 0;
+  self->item = malloc(n * sizeof(*self->item));
+  self->chave = malloc(n * sizeof(*self->chave));
+  self->posicao = malloc(n * sizeof(*self->posicao));
+  assert(self->item != NULL && self->chave != NULL && self->posicao != NULL);
+  for (int it = 0; it < n; it++) {
+    self->posicao[it] = -1;
+  }
+  return self;
+}
+
+void heap_destroi(heap_t *self)
+{
+  free(self->item);
+  free(self->chave);
+  free(self->posicao);
+  free(self);
+}
+
+void heap_aumenta(heap_t *self, int n)
+{
+  assert(n >= self->n);
+  self->item = realloc(self->item, n * sizeof(*self->item));
+  self->chave = realloc(self->chave, n * sizeof(*self->chave));
+  self->posicao = realloc(self->posicao, n * sizeof(*self->posicao));
+  assert(self->item != NULL && self->chave != NULL && self->posicao != NULL);
+  for (int it = self->n; it < n; it++) {
+    self->posicao[it] = -1;
+  }
+  self->n = n;
+}
+
+int heap_n_itens(heap_t *self)
+{
+  return self->n_itens;
+}
+
+bool heap_contem(heap_t *self, int item)
+{
+  assert(item >= 0 && item < self->n);
+  return self->posicao[item] != -1;
+}
+
+// true se o item na posição i do heap deve ficar antes do que está em j
+static bool heap__antes(heap_t *self, int i, int j)
+{
+  int a = self->item[i];
+  int b = self->item[j];
+  if (self->chave[a] != self->chave[b]) return self->chave[a] < self->chave[b];
+  return a < b;
+}
+
+static void heap__troca(heap_t *self, int i, int j)
+{
+  int a = self->item[i];
+  self->item[i] = self->item[j];
+  self->item[j] = a;
+  self->posicao[self->item[i]] = i;
+  self->posicao[self->item[j]] = j;
+}
+
+static void heap__sobe(heap_t *self, int i)
+{
+  while (i > 0) {
+    int pai = (i - 1) / 2;
+    if (!heap__antes(self, i, pai)) break;
+    heap__troca(self, i, pai);
+    i = pai;
+  }
+}
+
+static void heap__desce(heap_t *self, int i)
+{
+  for (;;) {
+    int menor = i;
+    int esq = 2 * i + 1;
+    int dir = esq + 1;
+    if (esq < self->n_itens && heap__antes(self, esq, menor)) menor = esq;
+    if (dir < self->n_itens && heap__antes(self, dir, menor)) menor = dir;
+    if (menor == i) break;
+    heap__troca(self, i, menor);
+    i = menor;
+  }
+}
+
+void heap_insere(heap_t *self, int item, long chave)
+{
+  assert(item >= 0 && item < self->n);
+  int i = self->posicao[item];
+  if (i == -1) {
+    i = self->n_itens++;
+    self->item[i] = item;
+    self->posicao[item] = i;
+  }
+  self->chave[item] = chave;
+  heap__sobe(self, i);
+  heap__desce(self, self->posicao[item]);
+}
+
+void heap_remove(heap_t *self, int item)
+{
+  assert(item >= 0 && item < self->n);
+  int i = self->posicao[item];
+  if (i == -1) return;
+  int ultimo = --self->n_itens;
+  if (i != ultimo) {
+    heap__troca(self, i, ultimo);
+    // o que era o último está agora na posição i, pode ter que subir ou descer
+    int movido = self->item[i];
+    heap__sobe(self, i);
+    heap__desce(self, self->posicao[movido]);
+  }
+  self->posicao[item] = -1;
+}
+
+long heap_chave(heap_t *self, int item)
+{
+  assert(heap_contem(self, item));
+  return self->chave[item];
+}
+
+int heap_menor(heap_t *self)
+{
+  if (self->n_itens == 0) return -1;
+  return self->item[0];
+}
+
+void heap_esvazia(heap_t *self)
+{
+  for (int i = 0; i < self->n_itens; i++) {
+    self->posicao[self->item[i]] = -1;
+  }
+  self->n_itens = 0;
+}
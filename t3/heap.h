@@ -0,0 +1,50 @@
+// heap.h
+// fila de prioridade (heap de mínimo) indexada
+// simulador de computador
+// so25b
+
+#ifndef HEAP_H
+#define HEAP_H
+
+// guarda itens identificados por inteiros entre 0 e n-1 (por exemplo, o
+//   número de um quadro ou o índice de um processo), cada um com uma chave
+// o menor item é o de menor chave; entre chaves iguais, o de menor número
+// cada item sabe sua posição no heap, então inserir, remover ou alterar a
+//   chave de um item qualquer custa O(log n), e achar o menor custa O(1)
+
+#include <stdbool.h>
+
+typedef struct heap_t heap_t;
+
+// cria um heap vazio, para itens entre 0 e 'n'-1
+heap_t *heap_cria(int n);
+
+// destrói um heap
+// nenhuma outra operação pode ser realizada no heap após esta chamada
+void heap_destroi(heap_t *self);
+
+// aumenta para 'n' o número de itens possíveis (0 a n-1)
+void heap_aumenta(heap_t *self, int n);
+
+// retorna o número de itens no heap
+int heap_n_itens(heap_t *self);
+
+// retorna true se o item está no heap
+bool heap_contem(heap_t *self, int item);
+
+// coloca o item no heap com a chave 'chave'; se já estiver, altera a chave
+void heap_insere(heap_t *self, int item, long chave);
+
+// retira o item do heap (não faz nada se não estiver)
+void heap_remove(heap_t *self, int item);
+
+// retorna a chave do item, que deve estar no heap
+long heap_chave(heap_t *self, int item);
+
+// retorna o menor item, sem retirar, ou -1 se o heap estiver vazio
+int heap_menor(heap_t *self);
+
+// retira todos os itens
+void heap_esvazia(heap_t *self);
+
+#endif // HEAP_H
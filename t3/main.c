@@ -9,29 +9,46 @@
 #include "mmu.h"
 #include "cpu.h"
 #include "relogio.h"
+#include "registro.h"
 #include "console.h"
 #include "terminal.h"
 #include "es.h"
 #include "dispositivos.h"
 #include "so.h"
+#include "snapshot.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 // constantes
 #define MEM_TAM 10000        // tamanho da memória principal
+#define TAM_PAGINA 10        // tamanho padrão de página (pode ser mudado com -p)
+// número de CPUs (até MAX_CPUS); pode ser definido no make (ver Makefile)
+#ifndef N_CPUS
+#define N_CPUS 1
+#endif
+#define ARQ_SNAPSHOT "snapshot_da_maquina" // onde o comando 'S' salva o snapshot
 
 // estrutura com os componentes do computador simulado
 typedef struct {
   mem_t *mem;
-  mmu_t *mmu;
-  cpu_t *cpu;
+  // cada CPU tem a sua MMU
+  mmu_t *mmu[N_CPUS];
+  cpu_t *cpu[N_CPUS];
   relogio_t *relogio;
+  registro_t *registro;
   console_t *console;
   es_t *es;
   controle_t *controle;
 } hardware_t;
 
+// a máquina completa, como é salva em um snapshot
+typedef struct {
+  hardware_t *hw;
+  so_t *so;
+} maquina_t;
+
 
 // registra no controlador de es os 4 dispositivos do terminal 'id_term'
 //   da console, com valores a partir de n_disp
@@ -80,17 +97,27 @@ static void inicializa_rom(mem_t *mem)
   prog_destroi(prog);
 }
 
-static void cria_hardware(hardware_t *hw)
+static void cria_hardware(hardware_t *hw, registro_modo_t modo_registro, char *nome_registro,
+                          int tam_pagina)
 {
   // cria a memória
   hw->mem = mem_cria(MEM_TAM);
   inicializa_rom(hw->mem);
-  // cria a MMU
-  hw->mmu = mmu_cria(hw->mem);
+  // cria as MMUs
+  hw->mmu[0] = mmu_cria(hw->mem, tam_pagina);
+  for (int c = 1; c < N_CPUS; c++) {
+    hw->mmu[c] = mmu_cria_outra(hw->mmu[0]);
+  }
 
   // cria dispositivos de E/S
-  hw->console = console_cria();
   hw->relogio = relogio_cria();
+  // as entradas externas passam pelo registro (que pode gravá-las ou reproduzi-las)
+  hw->registro = registro_cria(modo_registro, nome_registro, hw->relogio);
+  if (hw->registro == NULL) {
+    fprintf(stderr, "Não foi possível usar o arquivo de registro '%s'\n", nome_registro);
+    exit(1);
+  }
+  hw->console = console_cria(hw->registro);
 
   // cria o controlador de E/S e registra os dispositivos
   //   por exemplo, o dispositivo 8 do controlador de E/S (e da CPU) será o
@@ -103,42 +130,187 @@ static void cria_hardware(hardware_t *hw)
   registra_terminal(hw, D_TERM_D, 'D');
   // registra os 4 dispositivos do relógio
   es_registra_dispositivo(hw->es, D_RELOGIO_INSTRUCOES, hw->relogio, 0, relogio_leitura, NULL);
-  es_registra_dispositivo(hw->es, D_RELOGIO_REAL      , hw->relogio, 1, relogio_leitura, NULL);
+  //   o tempo real é lido pelo registro, que lê do relógio
+  es_registra_dispositivo(hw->es, D_RELOGIO_REAL      , hw->registro, 0, registro_leitura, NULL);
   es_registra_dispositivo(hw->es, D_RELOGIO_TIMER     , hw->relogio, 2, relogio_leitura, relogio_escrita);
   es_registra_dispositivo(hw->es, D_RELOGIO_INTERRUPCAO,hw->relogio, 3, relogio_leitura, relogio_escrita);
 
-  // cria a unidade de execução e inicializa com a MMU e o controlador de E/S
-  hw->cpu = cpu_cria(hw->mmu, hw->es);
+  // cria as unidades de execução e inicializa com a MMU e o controlador de E/S
+  //   só a primeira executa o reset, as outras esperam uma interrupção
+  for (int c = 0; c < N_CPUS; c++) {
+    hw->cpu[c] = cpu_cria(hw->mmu[c], hw->es);
+    if (c > 0) cpu_dorme(hw->cpu[c]);
+  }
 
-  // cria o controlador da CPU e inicializa com a unidade de execução, a console e
-  //   o relógio
-  hw->controle = controle_cria(hw->cpu, hw->console, hw->relogio);
+  // cria o controlador da CPU e inicializa com as unidades de execução, a
+  //   console e o relógio
+  hw->controle = controle_cria(hw->cpu[0], hw->console, hw->relogio);
+  for (int c = 1; c < N_CPUS; c++) {
+    controle_adiciona_cpu(hw->controle, hw->cpu[c]);
+  }
 }
 
 static void destroi_hardware(hardware_t *hw)
 {
   controle_destroi(hw->controle);
-  cpu_destroi(hw->cpu);
+  for (int c = 0; c < N_CPUS; c++) {
+    cpu_destroi(hw->cpu[c]);
+  }
   es_destroi(hw->es);
   relogio_destroi(hw->relogio);
   console_destroi(hw->console);
-  mmu_destroi(hw->mmu);
+  registro_destroi(hw->registro);
+  for (int c = 0; c < N_CPUS; c++) {
+    mmu_destroi(hw->mmu[c]);
+  }
   mem_destroi(hw->mem);
 }
 
-int main()
+// salva ou carrega o estado de todos os componentes da máquina
+// o controlador de E/S não tem estado próprio, a MMU só tem a área de
+//   salvamento da CPU (a tabela de páginas em uso é definida pelo SO); a
+//   console só tem os terminais
+static void snapshot_maquina(maquina_t *maq, snapshot_t *snap)
+{
+  snapshot_confere(snap, 'R');
+  relogio_snapshot(maq->hw->relogio, snap);
+  snapshot_confere(snap, 'M');
+  mem_snapshot(maq->hw->mem, snap);
+  snapshot_confere(snap, 'T');
+  console_snapshot(maq->hw->console, snap);
+  snapshot_confere(snap, 'C');
+  snapshot_confere(snap, N_CPUS);
+  for (int c = 0; c < N_CPUS; c++) {
+    cpu_snapshot(maq->hw->cpu[c], snap);
+    mmu_snapshot(maq->hw->mmu[c], snap);
+  }
+  snapshot_confere(snap, 'S');
+  so_snapshot(maq->so, snap);
+  snapshot_confere(snap, 'F');
+}
+
+// salva a máquina em um snapshot no arquivo ARQ_SNAPSHOT
+// é chamada pelo controlador, quando o operador digita o comando 'S'
+static bool salva_maquina(void *arg)
+{
+  snapshot_t *snap = snapshot_abre(ARQ_SNAPSHOT, false);
+  if (snap == NULL) return false;
+  snapshot_maquina(arg, snap);
+  if (!snapshot_fecha(snap)) return false;
+  console_printf("Snapshot salvo em '%s'", ARQ_SNAPSHOT);
+  return true;
+}
+
+// carrega a máquina do snapshot no arquivo 'nome_arq'
+// se houver erro no meio da carga, a máquina fica inconsistente
+static bool carrega_maquina(maquina_t *maq, char *nome_arq)
+{
+  snapshot_t *snap = snapshot_abre(nome_arq, true);
+  if (snap == NULL) return false;
+  snapshot_maquina(maq, snap);
+  if (!snapshot_fecha(snap)) return false;
+  console_printf("Snapshot carregado de '%s'", nome_arq);
+  return true;
+}
+
+// interpreta os argumentos da linha de comando:
+//   -g arquivo  grava as entradas externas da simulação no arquivo
+//   -r arquivo  reproduz a simulação gravada no arquivo, sem usar a tela
+//   -c arquivo  continua a simulação a partir do snapshot salvo no arquivo
+//   -p tamanho  usa páginas com esse tamanho (em palavras), em vez de TAM_PAGINA
+//   -s politica usa essa política de substituição de páginas (ver
+//               so_define_politica_subst)
+//   -o          compara no relatório as faltas de página com as do algoritmo
+//               ótimo
+static void verifica_args(int argc, char *argv[argc],
+                          registro_modo_t *pmodo, char **pnome,
+                          char **pnome_snapshot, int *ptam_pagina,
+                          char **ppolitica, bool *potimo)
+{
+  *pmodo = REG_DESLIGADO;
+  *pnome = NULL;
+  *pnome_snapshot = NULL;
+  *ptam_pagina = TAM_PAGINA;
+  *ppolitica = NULL;
+  *potimo = false;
+  for (int argi = 1; argi < argc; argi++) {
+    if (strcmp(argv[argi], "-g") == 0 && argi + 1 < argc) {
+      *pmodo = REG_GRAVA;
+      *pnome = argv[++argi];
+    } else if (strcmp(argv[argi], "-r") == 0 && argi + 1 < argc) {
+      *pmodo = REG_REPRODUZ;
+      *pnome = argv[++argi];
+    } else if (strcmp(argv[argi], "-c") == 0 && argi + 1 < argc) {
+      *pnome_snapshot = argv[++argi];
+    } else if (strcmp(argv[argi], "-p") == 0 && argi + 1 < argc) {
+      char *fim;
+      long tam = strtol(argv[++argi], &fim, 10);
+      if (*fim != '\0' || tam < 1 || tam > MEM_TAM) {
+        fprintf(stderr, "ERRO: tamanho de página inválido '%s'\n", argv[argi]);
+        exit(1);
+      }
+      *ptam_pagina = tam;
+    } else if (strcmp(argv[argi], "-s") == 0 && argi + 1 < argc) {
+      *ppolitica = argv[++argi];
+    } else if (strcmp(argv[argi], "-o") == 0) {
+      *potimo = true;
+    } else {
+      fprintf(stderr, "ERRO: chame como '%s [-g arquivo | -r arquivo] [-c arquivo] [-p tamanho] [-s politica] [-o]'\n", argv[0]);
+      exit(1);
+    }
+  }
+}
+
+int main(int argc, char *argv[argc])
 {
   hardware_t hw;
   so_t *so;
+  registro_modo_t modo_registro;
+  char *nome_registro;
+  char *nome_snapshot;
+  int tam_pagina;
+  char *politica;
+  bool otimo;
+
+  verifica_args(argc, argv, &modo_registro, &nome_registro, &nome_snapshot,
+                &tam_pagina, &politica, &otimo);
 
   // cria o hardware
-  cria_hardware(&hw);
+  cria_hardware(&hw, modo_registro, nome_registro, tam_pagina);
   // cria o sistema operacional
-  so = so_cria(hw.cpu, hw.mem, hw.mmu, hw.es, hw.console);
+  so = so_cria(hw.cpu[0], hw.mem, hw.mmu[0], hw.es, hw.console);
+  for (int c = 1; c < N_CPUS; c++) {
+    so_adiciona_cpu(so, hw.cpu[c], hw.mmu[c]);
+  }
+  if (politica != NULL && !so_define_politica_subst(so, politica)) {
+    console_printf("Política de substituição desconhecida '%s'", politica);
+    so_destroi(so);
+    destroi_hardware(&hw);
+    return 1;
+  }
+  if (otimo) so_registra_traco(so);
+
+  // o comando 'S' da console salva um snapshot; com '-c', a simulação
+  //   continua de um snapshot em vez de começar do reset
+  maquina_t maq = { &hw, so };
+  controle_define_snapshot(hw.controle, salva_maquina, &maq);
+  if (nome_snapshot != NULL && !carrega_maquina(&maq, nome_snapshot)) {
+    console_printf("Não foi possível carregar o snapshot '%s'", nome_snapshot);
+    so_destroi(so);
+    destroi_hardware(&hw);
+    return 1;
+  }
 
   // executa o laço principal do controlador
   controle_laco(hw.controle);
   so_gera_relatorio(so);
+  for (int c = 0; c < N_CPUS; c++) {
+    // o perfil de cada CPU vai para um arquivo: perfil_da_cpu, perfil_da_cpu1...
+    char arq_perfil[30] = "perfil_da_cpu";
+    if (c > 0) sprintf(arq_perfil + strlen(arq_perfil), "%d", c);
+    if (N_CPUS > 1) console_printf("\n[CPU %d]", c);
+    cpu_gera_relatorio(hw.cpu[c], arq_perfil);
+  }
   
   // destroi tudo
   so_destroi(so);
@@ -6,12 +6,19 @@
 #include "memoria.h"
 
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 // tipo de dados para representar uma região de memória
 struct mem_t {
   int tam;
   int *conteudo;
+  // o conteúdo é um arquivo mapeado (mmap) em vez de alocado com malloc
+  bool mapeada;
 };
 
 
@@ -27,6 +34,33 @@ mem_t *mem_cria(int tam)
   assert(self->conteudo != NULL);
 
   self->tam = tam;
+  self->mapeada = false;
+
+  return self;
+}
+
+mem_t *mem_cria_em_arquivo(int tam, char *nome_arq)
+{
+  size_t n_bytes = (size_t)tam * sizeof(int);
+  if (tam <= 0) return NULL;
+  int fd = open(nome_arq, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return NULL;
+  // ftruncate aumenta o arquivo preenchendo com zeros
+  if (ftruncate(fd, n_bytes) != 0) {
+    close(fd);
+    return NULL;
+  }
+  int *conteudo = mmap(NULL, n_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  // o mapeamento continua valendo depois de fechar o arquivo
+  close(fd);
+  if (conteudo == MAP_FAILED) return NULL;
+
+  mem_t *self;
+  self = malloc(sizeof(*self));
+  assert(self != NULL);
+  self->conteudo = conteudo;
+  self->tam = tam;
+  self->mapeada = true;
 
   return self;
 }
@@ -34,7 +68,10 @@ mem_t *mem_cria(int tam)
 void mem_destroi(mem_t *self)
 {
   if (self != NULL) {
-    if (self->conteudo != NULL) {
+    if (self->mapeada) {
+      // as alterações já estão no arquivo, munmap só desfaz o mapeamento
+      munmap(self->conteudo, (size_t)self->tam * sizeof(int));
+    } else if (self->conteudo != NULL) {
       free(self->conteudo);
     }
     free(self);
@@ -72,3 +109,42 @@ err_t mem_escreve(mem_t *self, int endereco, int valor)
   }
   return err;
 }
+
+// função auxiliar, verifica se os 'n' endereços a partir de 'endereco' são
+//   válidos
+static err_t verifica_regiao(mem_t *self, int endereco, int n)
+{
+  if (n < 0 || endereco < 0 || endereco > self->tam - n) {
+    return ERR_END_INV;
+  }
+  return ERR_OK;
+}
+
+err_t mem_copia_bloco(mem_t *destino, int end_destino,
+                      mem_t *origem, int end_origem, int n)
+{
+  err_t err = verifica_regiao(destino, end_destino, n);
+  if (err == ERR_OK) err = verifica_regiao(origem, end_origem, n);
+  if (err == ERR_OK) {
+    memmove(&destino->conteudo[end_destino], &origem->conteudo[end_origem],
+            n * sizeof(*destino->conteudo));
+  }
+  return err;
+}
+
+err_t mem_preenche(mem_t *self, int endereco, int n, int valor)
+{
+  err_t err = verifica_regiao(self, endereco, n);
+  if (err == ERR_OK) {
+    for (int i = 0; i < n; i++) {
+      self->conteudo[endereco + i] = valor;
+    }
+  }
+  return err;
+}
+
+void mem_snapshot(mem_t *self, snapshot_t *snap)
+{
+  snapshot_confere(snap, self->tam);
+  snapshot_vetor(snap, self->tam, self->conteudo);
+}
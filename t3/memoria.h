@@ -6,10 +6,12 @@
 
 // A memória é um vetor de inteiros, com um inteiro em cada posição, entre 0
 //   e tam-1 (tam é o tamanho da memória, especificado na criação).
-// Tem só 3 operações:
+// Tem 3 operações principais:
 // - obter o tamanho da memória
 // - obter o valor do inteiro que está em uma das posições
 // - alterar o valor o inteiro que está em uma das posições
+// e operações em blocos de posições, para copiar ou preencher várias posições
+//   de uma vez
 //
 // O único erro possível no acesso é uma tentativa de acesso a uma posição
 //   inexistente
@@ -18,6 +20,7 @@
 #define MEMORIA_H
 
 #include "err.h"
+#include "snapshot.h"
 
 // tipo opaco que representa a memória
 typedef struct mem_t mem_t;
@@ -27,6 +30,14 @@ typedef struct mem_t mem_t;
 //   as operações sobre essa memória
 mem_t *mem_cria(int tam);
 
+// cria uma região de memória com capacidade para 'tam' valores, guardados no
+//   arquivo 'nome_arq' do hospedeiro (mapeado na memória com mmap)
+// o arquivo é criado (ou truncado) com todos os valores 0, e o conteúdo da
+//   região continua nele depois da destruição, um int (binário, na ordem de
+//   bytes do hospedeiro) por endereço
+// retorna NULL se não for possível criar ou mapear o arquivo
+mem_t *mem_cria_em_arquivo(int tam, char *nome_arq);
+
 // destrói uma região de memória
 // nenhuma outra operação pode ser realizada na região após esta chamada
 void mem_destroi(mem_t *self);
@@ -42,4 +53,21 @@ err_t mem_le(mem_t *self, int endereco, int *pvalor);
 // retorna erro ERR_END_INV se endereço inválido
 err_t mem_escreve(mem_t *self, int endereco, int valor);
 
+// copia 'n' valores da memória 'origem', a partir do endereço 'end_origem',
+//   para a memória 'destino', a partir do endereço 'end_destino'
+// as memórias podem ser a mesma, e as regiões podem se sobrepor
+// retorna erro ERR_END_INV (e não copia nada) se alguma das regiões não
+//   estiver inteira na sua memória
+err_t mem_copia_bloco(mem_t *destino, int end_destino,
+                      mem_t *origem, int end_origem, int n);
+
+// coloca 'valor' nos 'n' endereços a partir de 'endereco'
+// retorna erro ERR_END_INV (e não altera nada) se a região não estiver inteira
+//   na memória
+err_t mem_preenche(mem_t *self, int endereco, int n, int valor);
+
+// salva ou carrega o conteúdo da memória (ver snapshot.h)
+// o snapshot só pode ser carregado em uma memória do mesmo tamanho
+void mem_snapshot(mem_t *self, snapshot_t *snap);
+
 #endif // MEMORIA_H
@@ -7,35 +7,282 @@
 #include <stdlib.h>
 #include <assert.h>
 
+// tamanho da área de salvamento própria de cada MMU
+#define TAM_SALVAMENTO (CPU_END_FIM_SALVAMENTO - CPU_END_PC + 1)
+
+// versões do conteúdo dos quadros físicos, compartilhadas pelas MMUs que
+//   acessam a mesma memória
+typedef struct {
+  int n_mmus;
+  int n_quadros;
+  unsigned *versao;
+} versoes_t;
+
+// uma entrada da TLB
+typedef struct {
+  bool valida;
+  int asid;
+  int pagina;
+  int quadro;
+  // o bit de alteração da página já foi marcado na tabela por esta entrada
+  //   (o de acesso é marcado quando a entrada é preenchida)
+  bool alterada;
+} entrada_tlb_t;
+
 // tipo de dados opaco para representar uma MMU
 struct mmu_t {
   // memória física
   mem_t *mem;
+  // tamanho da página; se for potência de 2, 'bits_desloc' é o número de
+  //   bits do deslocamento dentro da página, e 'mascara_desloc' é a máscara
+  //   para obtê-lo; senão, 'bits_desloc' é -1
+  int tam_pagina;
+  int bits_desloc;
+  int mascara_desloc;
   // tabela de páginas
   tabpag_t *tabpag;
+  // versão do conteúdo de cada quadro físico, alterada a cada escrita
+  versoes_t *versoes;
+  // área de salvamento da CPU desta MMU
+  int salvamento[TAM_SALVAMENTO];
+  // ASID da tabela de páginas em uso
+  int asid;
+  // TLB, com entradas de várias tabelas, identificadas pelo ASID
+  entrada_tlb_t tlb[TLB_N_CONJUNTOS][TLB_N_VIAS];
+  // a próxima via a substituir em cada conjunto
+  int proxima_via[TLB_N_CONJUNTOS];
+  long tlb_acertos;
+  long tlb_faltas;
+  long tlb_invalidacoes;
+  long tlb_esvaziamentos;
+  // onde registrar as referências às páginas (NULL para não registrar)
+  traco_t *traco;
 };
 
-mmu_t *mmu_cria(mem_t *mem)
+static void mmu__esvazia_tlb(mmu_t *self);
+
+static mmu_t *mmu__cria(mem_t *mem, int tam_pagina, versoes_t *versoes)
 {
   mmu_t *self;
   self = malloc(sizeof(*self));
   assert(self != NULL);
+  assert(tam_pagina > 0);
   self->mem = mem;
+  self->tam_pagina = tam_pagina;
+  self->bits_desloc = -1;
+  self->mascara_desloc = tam_pagina - 1;
+  if ((tam_pagina & (tam_pagina - 1)) == 0) {
+    self->bits_desloc = 0;
+    while ((1 << self->bits_desloc) < tam_pagina) self->bits_desloc++;
+  }
   self->tabpag = NULL;
+  self->asid = 0;
+  self->versoes = versoes;
+  versoes->n_mmus++;
+  for (int i = 0; i < TAM_SALVAMENTO; i++) self->salvamento[i] = 0;
+  mmu__esvazia_tlb(self);
+  self->tlb_acertos = 0;
+  self->tlb_faltas = 0;
+  self->tlb_invalidacoes = 0;
+  self->tlb_esvaziamentos = 0;
+  self->traco = NULL;
   return self;
 }
 
+mmu_t *mmu_cria(mem_t *mem, int tam_pagina)
+{
+  versoes_t *versoes = malloc(sizeof(*versoes));
+  assert(versoes != NULL);
+  versoes->n_mmus = 0;
+  versoes->n_quadros = (mem_tam(mem) + tam_pagina - 1) / tam_pagina;
+  versoes->versao = calloc(versoes->n_quadros, sizeof(*versoes->versao));
+  assert(versoes->versao != NULL);
+  return mmu__cria(mem, tam_pagina, versoes);
+}
+
+mmu_t *mmu_cria_outra(mmu_t *outra)
+{
+  return mmu__cria(outra->mem, outra->tam_pagina, outra->versoes);
+}
+
 void mmu_destroi(mmu_t *self)
 {
   if (self != NULL) {
     // nem a tabela de páginas nem a memória pertencem à MMU, não são destruídas aqui
+    if (--self->versoes->n_mmus == 0) {
+      free(self->versoes->versao);
+      free(self->versoes);
+    }
     free(self);
   }
 }
 
 void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag)
 {
+  // a TLB não é esvaziada, as entradas de cada tabela têm o ASID dela
   self->tabpag = tabpag;
+  self->asid = tabpag == NULL ? 0 : tabpag_asid(tabpag);
+}
+
+tabpag_t *mmu_tabpag(mmu_t *self)
+{
+  return self->tabpag;
+}
+
+void mmu_define_traco(mmu_t *self, traco_t *traco)
+{
+  self->traco = traco;
+}
+
+void mmu_registra_referencia(mmu_t *self, int pagina)
+{
+  if (self->traco != NULL && self->tabpag != NULL) {
+    traco_registra(self->traco, self->asid, pagina);
+  }
+}
+
+// número da página de 'end' e deslocamento dele dentro dela
+// usados em todo acesso traduzido -- evitam a divisão se puderem
+static inline int mmu__pagina(mmu_t *self, int end)
+{
+  if (end < 0) return -1;
+  if (self->bits_desloc >= 0) return end >> self->bits_desloc;
+  return end / self->tam_pagina;
+}
+
+static inline int mmu__deslocamento(mmu_t *self, int end)
+{
+  if (self->bits_desloc >= 0) return end & self->mascara_desloc;
+  return end % self->tam_pagina;
+}
+
+int mmu_tam_pagina(mmu_t *self)
+{
+  return self->tam_pagina;
+}
+
+int mmu_pagina(mmu_t *self, int end)
+{
+  return mmu__pagina(self, end);
+}
+
+unsigned mmu_versao_quadro(mmu_t *self, int quadro)
+{
+  if (quadro < 0 || quadro >= self->versoes->n_quadros) return 0;
+  return self->versoes->versao[quadro];
+}
+
+// registra que o conteúdo do endereço físico 'endfis' foi alterado
+static void mmu__marca_escrita(mmu_t *self, int endfis)
+{
+  self->versoes->versao[mmu__pagina(self, endfis)]++;
+}
+
+// retorna true se 'endfis' está na área de salvamento
+static bool mmu__salvamento(int endfis)
+{
+  return endfis >= CPU_END_PC && endfis <= CPU_END_FIM_SALVAMENTO;
+}
+
+// acesso a um endereço físico, na área de salvamento ou na memória
+static err_t mmu__le_fis(mmu_t *self, int endfis, int *pvalor)
+{
+  if (mmu__salvamento(endfis)) {
+    *pvalor = self->salvamento[endfis - CPU_END_PC];
+    return ERR_OK;
+  }
+  return mem_le(self->mem, endfis, pvalor);
+}
+
+static err_t mmu__escreve_fis(mmu_t *self, int endfis, int valor)
+{
+  if (mmu__salvamento(endfis)) {
+    self->salvamento[endfis - CPU_END_PC] = valor;
+    return ERR_OK;
+  }
+  err_t err = mem_escreve(self->mem, endfis, valor);
+  if (err == ERR_OK) mmu__marca_escrita(self, endfis);
+  return err;
+}
+
+static void mmu__esvazia_tlb(mmu_t *self)
+{
+  for (int c = 0; c < TLB_N_CONJUNTOS; c++) {
+    for (int v = 0; v < TLB_N_VIAS; v++) {
+      self->tlb[c][v].valida = false;
+    }
+    self->proxima_via[c] = 0;
+  }
+}
+
+// o conjunto da TLB onde pode estar a tradução de 'pagina' na tabela 'asid'
+// o ASID entra no cálculo para que as mesmas páginas de processos diferentes
+//   (o início do código, por exemplo) não disputem o mesmo conjunto
+static int mmu__conjunto_tlb(int asid, int pagina)
+{
+  return (pagina ^ asid) % TLB_N_CONJUNTOS;
+}
+
+// retorna a entrada da TLB com a tradução de 'pagina' na tabela em uso,
+//   preenchendo-a a partir da tabela se necessário
+// marca o bit de acesso na tabela quando preenche a entrada, e o de alteração
+//   no primeiro acesso de escrita por ela
+// retorna NULL se a página for inválida
+static entrada_tlb_t *mmu__entrada_tlb(mmu_t *self, int pagina, bool escrita)
+{
+  if (pagina < 0) return NULL;
+  int conj = mmu__conjunto_tlb(self->asid, pagina);
+  entrada_tlb_t *entrada = NULL;
+  for (int v = 0; v < TLB_N_VIAS; v++) {
+    entrada_tlb_t *e = &self->tlb[conj][v];
+    if (e->valida && e->pagina == pagina && e->asid == self->asid) {
+      entrada = e;
+      break;
+    }
+  }
+  if (entrada == NULL) {
+    // não está na TLB -- substitui as entradas do conjunto em ordem circular
+    self->tlb_faltas++;
+    int quadro;
+    if (tabpag_traduz(self->tabpag, pagina, &quadro) != ERR_OK) return NULL;
+    entrada = &self->tlb[conj][self->proxima_via[conj]];
+    self->proxima_via[conj] = (self->proxima_via[conj] + 1) % TLB_N_VIAS;
+    entrada->valida = true;
+    entrada->asid = self->asid;
+    entrada->pagina = pagina;
+    entrada->quadro = quadro;
+    entrada->alterada = escrita;
+    tabpag_marca_bit_acesso(self->tabpag, pagina, escrita);
+    return entrada;
+  }
+  self->tlb_acertos++;
+  if (escrita && !entrada->alterada) {
+    entrada->alterada = true;
+    tabpag_marca_bit_acesso(self->tabpag, pagina, true);
+  }
+  return entrada;
+}
+
+void mmu_invalida_pagina(mmu_t *self, int asid, int pagina)
+{
+  if (pagina < 0) return;
+  int conj = mmu__conjunto_tlb(asid, pagina);
+  for (int v = 0; v < TLB_N_VIAS; v++) {
+    entrada_tlb_t *e = &self->tlb[conj][v];
+    if (e->valida && e->pagina == pagina && e->asid == asid) {
+      e->valida = false;
+      self->tlb_invalidacoes++;
+    }
+  }
+}
+
+void mmu_estatisticas_tlb(mmu_t *self, long *pacertos, long *pfaltas,
+                          long *pinvalidacoes, long *pesvaziamentos)
+{
+  *pacertos = self->tlb_acertos;
+  *pfaltas = self->tlb_faltas;
+  *pinvalidacoes = self->tlb_invalidacoes;
+  *pesvaziamentos = self->tlb_esvaziamentos;
 }
 
 // traduz o endereço virtual 'endvirt', colocando o endereço físico
@@ -43,32 +290,37 @@ void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag)
 // retorna ERR_OK ou um erro se a tradução não for possível
 static err_t mmu__traduz(mmu_t *self, int endvirt, int *pendfis)
 {
-  int pagina = endvirt / TAM_PAGINA;
-  int deslocamento = endvirt % TAM_PAGINA;
   int quadro;
-  err_t err = tabpag_traduz(self->tabpag, pagina, &quadro);
+  err_t err = tabpag_traduz(self->tabpag, mmu__pagina(self, endvirt), &quadro);
   if (err == ERR_OK) {
-    *pendfis = quadro * TAM_PAGINA + deslocamento;
+    *pendfis = quadro * self->tam_pagina + mmu__deslocamento(self, endvirt);
   }
   return err;
 }
 
+err_t mmu_traduz(mmu_t *self, int endvirt, int *pendfis, cpu_modo_t modo)
+{
+  if (modo == supervisor || self->tabpag == NULL) {
+    *pendfis = endvirt;
+    return ERR_OK;
+  }
+  return mmu__traduz(self, endvirt, pendfis);
+}
+
 err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo)
 {
   // em modo supervisor ou se não tiver tabela de páginas,
   //   não faz tradução de endereços, nem marca o acesso
   if (modo == supervisor || self->tabpag == NULL) {
-    return mem_le(self->mem, endvirt, pvalor);
-  }
-  int endfis;
-  err_t err = mmu__traduz(self, endvirt, &endfis);
-  if (err == ERR_OK) {
-    err = mem_le(self->mem, endfis, pvalor);
-    if (err == ERR_OK) {
-      tabpag_marca_bit_acesso(self->tabpag, endvirt / TAM_PAGINA, false);
-    }
+    return mmu__le_fis(self, endvirt, pvalor);
   }
-  return err;
+  // os bits de acesso são marcados pela TLB
+  int pagina = mmu__pagina(self, endvirt);
+  entrada_tlb_t *entrada = mmu__entrada_tlb(self, pagina, false);
+  if (entrada == NULL) return ERR_PAG_AUSENTE;
+  mmu_registra_referencia(self, pagina);
+  int endfis = entrada->quadro * self->tam_pagina + mmu__deslocamento(self, endvirt);
+  return mmu__le_fis(self, endfis, pvalor);
 }
 
 err_t mmu_escreve(mmu_t *self, int endvirt, int valor, cpu_modo_t modo)
@@ -76,15 +328,24 @@ err_t mmu_escreve(mmu_t *self, int endvirt, int valor, cpu_modo_t modo)
   // em modo supervisor ou se não tiver tabela de páginas,
   //   não faz tradução de endereços, nem marca o acesso
   if (modo == supervisor || self->tabpag == NULL) {
-    return mem_escreve(self->mem, endvirt, valor);
+    return mmu__escreve_fis(self, endvirt, valor);
   }
-  int endfis;
-  err_t err = mmu__traduz(self, endvirt, &endfis);
-  if (err == ERR_OK) {
-    err = mem_escreve(self->mem, endfis, valor);
-    if (err == ERR_OK) {
-      tabpag_marca_bit_acesso(self->tabpag, endvirt / TAM_PAGINA, true);
-    }
+  int pagina = mmu__pagina(self, endvirt);
+  entrada_tlb_t *entrada = mmu__entrada_tlb(self, pagina, true);
+  if (entrada == NULL) return ERR_PAG_AUSENTE;
+  mmu_registra_referencia(self, pagina);
+  int endfis = entrada->quadro * self->tam_pagina + mmu__deslocamento(self, endvirt);
+  return mmu__escreve_fis(self, endfis, valor);
+}
+
+void mmu_snapshot(mmu_t *self, snapshot_t *snap)
+{
+  snapshot_confere(snap, self->tam_pagina);
+  snapshot_confere(snap, TAM_SALVAMENTO);
+  snapshot_vetor(snap, TAM_SALVAMENTO, self->salvamento);
+  // as tabelas carregadas são novas, com outros ASIDs
+  if (snapshot_carregando(snap)) {
+    mmu__esvazia_tlb(self);
+    self->tlb_esvaziamentos++;
   }
-  return err;
 }
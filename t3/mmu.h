@@ -10,6 +10,9 @@
 // realiza a tradução de endereços virtuais do espaço de endereçamento
 //   de um processo em endereços físicos da memória principal
 // implementa memória virtual por paginação
+// cada CPU tem a sua MMU; os endereços físicos da área de salvamento da CPU
+//   (CPU_END_PC a CPU_END_FIM_SALVAMENTO) são mapeados em uma memória própria
+//   da MMU, para que cada CPU tenha a sua, as demais são da memória principal
 
 // tipo opaco que representa a MMU
 typedef struct mmu_t mmu_t;
@@ -18,26 +21,82 @@ typedef struct mmu_t mmu_t;
 #include "memoria.h"
 #include "err.h"
 #include "cpu.h"
+#include "snapshot.h"
+#include "traco.h"
 
-// tamanho de uma página, em palavras de memória
-// t3: pode ser alterado para comparar configurações diferentes
-#define TAM_PAGINA 10
+// TLB: cache de traduções dentro da MMU, associativo por conjunto
+// cada página só pode estar em um conjunto (que depende da página e do ASID
+//   da tabela), em uma das TLB_N_VIAS entradas dele
+// t3: podem ser alterados para comparar configurações diferentes
+#define TLB_N_CONJUNTOS 8
+#define TLB_N_VIAS 2
 
 // cria uma MMU para gerenciar acessos à memória
 // retorna um ponteiro para um descritor, que deverá ser usado em todas
 //   as operações nessa MMU
-// recebe 'mem', a memória física que será gerenciada
+// recebe 'mem', a memória física que será gerenciada, e o tamanho de uma
+//   página, em palavras de memória (maior que 0)
+// se o tamanho da página for potência de 2, a tradução é feita com
+//   deslocamento de bits e máscara em vez de divisão e resto
 // mata o programa em caso de erro (malloc)
-mmu_t *mmu_cria(mem_t *mem);
+mmu_t *mmu_cria(mem_t *mem, int tam_pagina);
+
+// cria uma MMU para outra CPU, que acessa a mesma memória que 'outra', com
+//   o mesmo tamanho de página
+// as versões dos quadros (ver mmu_versao_quadro) são compartilhadas entre
+//   elas, para que a escrita feita por uma CPU seja vista pelas outras
+mmu_t *mmu_cria_outra(mmu_t *outra);
 
 // destrói uma MMU
 // nenhuma outra operação pode ser realizada na MMU após esta chamada
 void mmu_destroi(mmu_t *self);
 
+// retorna o tamanho de uma página (e de um quadro), em palavras de memória
+int mmu_tam_pagina(mmu_t *self);
+
+// retorna o número da página que contém o endereço virtual 'end' (ou o do
+//   quadro que contém o endereço físico 'end')
+// retorna -1 se 'end' for negativo
+int mmu_pagina(mmu_t *self, int end);
+
 // define a tabela de páginas a usar nas próximas traduções
 // se tabpag for NULL, os acessos serão repassados à memória sem alteração
 void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag);
 
+// retorna a tabela de páginas em uso (ou NULL, se não houver)
+tabpag_t *mmu_tabpag(mmu_t *self);
+
+// define o traço onde são registradas as páginas referenciadas pelos acessos
+//   traduzidos (NULL, o inicial, para não registrar)
+// várias MMUs podem registrar no mesmo traço
+void mmu_define_traco(mmu_t *self, traco_t *traco);
+
+// registra no traço (se houver) uma referência a 'pagina' da tabela em uso,
+//   feita sem passar por mmu_le (instruções já decodificadas pela CPU)
+void mmu_registra_referencia(mmu_t *self, int pagina);
+
+// invalida a tradução de 'pagina' da tabela com ASID 'asid' (ver
+//   tabpag_asid) que a MMU possa ter guardada na TLB
+// a TLB guarda traduções de várias tabelas ao mesmo tempo e não é esvaziada
+//   quando a tabela em uso muda; como numa MMU real, ela não percebe mudanças
+//   feitas na tabela: quem invalida uma página ou zera o bit de acesso dela
+//   deve chamar esta função em todas as MMUs que possam ter usado a tabela
+void mmu_invalida_pagina(mmu_t *self, int asid, int pagina);
+
+// coloca nas posições apontadas pelos argumentos o número de traduções
+//   encontradas na TLB, o de traduções que tiveram que ser buscadas na
+//   tabela de páginas, o de entradas invalidadas (por mmu_invalida_pagina) e
+//   o número de vezes que a TLB foi esvaziada
+void mmu_estatisticas_tlb(mmu_t *self, long *pacertos, long *pfaltas,
+                          long *pinvalidacoes, long *pesvaziamentos);
+
+// traduz o endereço virtual 'endvirt', colocando o endereço físico
+//   correspondente na posição apontada por 'pendfis'
+// não acessa a memória nem marca a página como acessada
+// retorna erro se a tradução não for possível (ver tabpag_traduz)
+// em modo supervisor ou sem tabela de páginas, o endereço não é traduzido
+err_t mmu_traduz(mmu_t *self, int endvirt, int *pendfis, cpu_modo_t modo);
+
 // coloca na posição apontada por 'pvalor' o valor que está na memória
 //   no endereço físico correspondente ao endereço virtual 'endvirt'
 // marca a página como acessada se o acesso for bem sucedido
@@ -58,4 +117,16 @@ err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo);
 //   à memória sem tradução
 err_t mmu_escreve(mmu_t *self, int endvirt, int valor, cpu_modo_t modo);
 
+// retorna a versão do conteúdo do quadro físico 'quadro'
+// a versão muda a cada escrita bem sucedida feita pela MMU em um endereço
+//   desse quadro; é usada pela CPU para descartar instruções pré-decodificadas
+//   de um quadro que foi alterado
+// retorna 0 se o quadro não existir
+unsigned mmu_versao_quadro(mmu_t *self, int quadro);
+
+// salva ou carrega a área de salvamento da MMU (ver snapshot.h)
+// a MMU que carrega deve ter o mesmo tamanho de página da que salvou
+// ao carregar, a TLB é esvaziada
+void mmu_snapshot(mmu_t *self, snapshot_t *snap);
+
 #endif // MMU_H
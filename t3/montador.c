@@ -55,6 +55,7 @@ int mem_min = -1;       // menor endereço preenchido
 int mem_max = -1;       // maior endereço preenchido
 
 char *nome_fonte;   // nome do arquivo fonte a montar
+char *nome_mapa;    // nome do arquivo onde gravar o mapa de símbolos, se houver
 
 // coloca um valor no final da memória
 void mem_insere(int val)
@@ -100,6 +101,7 @@ void mem_imprime(void)
 struct {
   char *nome;
   int valor;
+  bool endereco;          // o símbolo é um label de posição da memória (não DEFINE)
 } simbolo[SIMB_TAM];
 int simb_num;             // número d símbolos na tabela
 
@@ -115,7 +117,7 @@ int simb_valor(char *nome)
 }
 
 // insere um novo símbolo na tabela
-void simb_novo(char *nome, int valor)
+void simb_novo(char *nome, int valor, bool endereco)
 {
   if (nome == NULL) return;
   if (simb_valor(nome) != -1) {
@@ -127,9 +129,27 @@ void simb_novo(char *nome, int valor)
   }
   simbolo[simb_num].nome = strdup(nome);
   simbolo[simb_num].valor = valor;
+  simbolo[simb_num].endereco = endereco;
   simb_num++;
 }
 
+// grava no arquivo 'nome' os labels de posições da memória, um por linha,
+//   com o endereço e o nome (usado pelo perfil de execução do simulador)
+void simb_grava_mapa(char *nome)
+{
+  FILE *arq = fopen(nome, "w");
+  if (arq == NULL) {
+    fprintf(stderr, "Não foi possível criar o arquivo '%s'\n", nome);
+    return;
+  }
+  for (int i = 0; i < simb_num; i++) {
+    if (simbolo[i].endereco) {
+      fprintf(arq, "%d %s\n", simbolo[i].valor, simbolo[i].nome);
+    }
+  }
+  fclose(arq);
+}
+
 
 // ---------------------------------------------------------------------
 // REFERÊNCIAS {{{1
@@ -235,7 +255,7 @@ void monta_define(int linha, char *label, char *arg)
     fprintf(stderr, "ERRO: linha %d 'DEFINE' exige valor numérico\n", linha);
   } else {
     // tudo OK, define o símbolo
-    simb_novo(label, argn);
+    simb_novo(label, argn, false);
   }
 }
 
@@ -252,7 +272,7 @@ void monta_linha(int linha, char *label, char *instrucao, char *arg)
   
   // cria símbolo correspondente ao label, se for o caso
   if (label != NULL) {
-    simb_novo(label, mem_pos);
+    simb_novo(label, mem_pos, true);
   }
   
   // verifica a existência de instrução e número correto de argumentos
@@ -408,12 +428,19 @@ void verifica_args(int argc, char *argv[argc])
         fprintf(stderr, "ERRO: endereço inválido: '%s'\n", argv[argi]);
         exit(1);
       }
+    } else if (strcmp(argv[argi], "-s") == 0) {
+      argi++;
+      if (argi >= argc) {
+        fprintf(stderr, "ERRO: falta nome do arquivo após '-s'\n");
+        exit(1);
+      }
+      nome_mapa = argv[argi];
     } else {
       nome_fonte = argv[argi];
     }
   }
   if (nome_fonte == NULL) {
-    fprintf(stderr, "ERRO: chame como '%s [-e end.inicial] nome_do_arquivo'\n",
+    fprintf(stderr, "ERRO: chame como '%s [-e end.inicial] [-s mapa_de_simbolos] nome_do_arquivo'\n",
             argv[0]);
     exit(1);
   }
@@ -424,6 +451,7 @@ int main(int argc, char *argv[argc])
   verifica_args(argc, argv);
   monta_arquivo(nome_fonte);
   mem_imprime();
+  if (nome_mapa != NULL) simb_grava_mapa(nome_mapa);
   return 0;
 }
 
@@ -0,0 +1,341 @@
+// perfil.c
+// perfil de execução: instruções executadas e faltas de página por endereço
+// simulador de computador
+// so25b
+
+#include "perfil.h"
+#include "instrucao.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// tamanho inicial da tabela de endereços (potência de 2)
+#define PERFIL_TAM_INICIAL 1024
+
+// contagens de um endereço de um processo
+typedef struct {
+  bool usado;
+  int pid;
+  int PC;
+  int opcode;
+  long instrucoes;
+  long faltas;
+} perfil_end_t;
+
+// um símbolo de um mapa de símbolos do montador
+typedef struct {
+  int valor;
+  char *nome;
+} simbolo_t;
+
+// um programa executado por um processo, e os símbolos dele (lidos só
+//   quando o relatório é gravado)
+typedef struct {
+  int pid;
+  char *nome_prog;
+  int n_simbolos;
+  simbolo_t *simbolos;
+} perfil_prog_t;
+
+struct perfil_t {
+  long total_instrucoes;
+  long total_faltas;
+  long por_opcode[N_OPCODE];
+  // tabela hash com as contagens por endereço, endereçamento aberto
+  int tam_tabela;
+  int n_enderecos;
+  perfil_end_t *enderecos;
+  // programas de cada processo
+  int n_programas;
+  perfil_prog_t *programas;
+};
+
+
+// ---------------------------------------------------------------------
+// CRIAÇÃO {{{1
+// ---------------------------------------------------------------------
+
+perfil_t *perfil_cria(void)
+{
+  perfil_t *self = malloc(sizeof(*self));
+  assert(self != NULL);
+
+  self->total_instrucoes = 0;
+  self->total_faltas = 0;
+  memset(self->por_opcode, 0, sizeof(self->por_opcode));
+  self->tam_tabela = PERFIL_TAM_INICIAL;
+  self->n_enderecos = 0;
+  self->enderecos = calloc(self->tam_tabela, sizeof(*self->enderecos));
+  assert(self->enderecos != NULL);
+  self->n_programas = 0;
+  self->programas = NULL;
+
+  return self;
+}
+
+void perfil_destroi(perfil_t *self)
+{
+  for (int i = 0; i < self->n_programas; i++) {
+    perfil_prog_t *prog = &self->programas[i];
+    for (int s = 0; s < prog->n_simbolos; s++) {
+      free(prog->simbolos[s].nome);
+    }
+    free(prog->simbolos);
+    free(prog->nome_prog);
+  }
+  free(self->programas);
+  free(self->enderecos);
+  free(self);
+}
+
+void perfil_define_programa(perfil_t *self, int pid, char *nome_prog)
+{
+  for (int i = 0; i < self->n_programas; i++) {
+    perfil_prog_t *prog = &self->programas[i];
+    if (prog->pid == pid && strcmp(prog->nome_prog, nome_prog) == 0) return;
+  }
+  self->programas = realloc(self->programas,
+                            (self->n_programas + 1) * sizeof(*self->programas));
+  assert(self->programas != NULL);
+  perfil_prog_t *prog = &self->programas[self->n_programas++];
+  prog->pid = pid;
+  prog->nome_prog = strdup(nome_prog);
+  assert(prog->nome_prog != NULL);
+  prog->n_simbolos = 0;
+  prog->simbolos = NULL;
+}
+
+
+// ---------------------------------------------------------------------
+// CONTAGEM {{{1
+// ---------------------------------------------------------------------
+
+static unsigned perfil__hash(int pid, int PC)
+{
+  return ((unsigned)pid * 31u + (unsigned)PC) * 2654435761u;
+}
+
+// insere 'end' na tabela, que tem espaço
+static perfil_end_t *perfil__insere(perfil_t *self, int pid, int PC)
+{
+  unsigned mascara = self->tam_tabela - 1;
+  unsigned i = perfil__hash(pid, PC) & mascara;
+  while (self->enderecos[i].usado) {
+    perfil_end_t *end = &self->enderecos[i];
+    if (end->pid == pid && end->PC == PC) return end;
+    i = (i + 1) & mascara;
+  }
+  perfil_end_t *end = &self->enderecos[i];
+  end->usado = true;
+  end->pid = pid;
+  end->PC = PC;
+  end->opcode = -1;
+  end->instrucoes = 0;
+  end->faltas = 0;
+  self->n_enderecos++;
+  return end;
+}
+
+// dobra o tamanho da tabela de endereços
+static void perfil__cresce(perfil_t *self)
+{
+  int tam_velho = self->tam_tabela;
+  perfil_end_t *velhos = self->enderecos;
+  self->tam_tabela *= 2;
+  self->n_enderecos = 0;
+  self->enderecos = calloc(self->tam_tabela, sizeof(*self->enderecos));
+  assert(self->enderecos != NULL);
+  for (int i = 0; i < tam_velho; i++) {
+    if (!velhos[i].usado) continue;
+    perfil_end_t *end = perfil__insere(self, velhos[i].pid, velhos[i].PC);
+    *end = velhos[i];
+  }
+  free(velhos);
+}
+
+// retorna as contagens do endereço 'PC' do processo 'pid', criando se
+//   necessário
+static perfil_end_t *perfil__endereco(perfil_t *self, int pid, int PC)
+{
+  // mantém a tabela no máximo 3/4 cheia
+  if ((self->n_enderecos + 1) * 4 > self->tam_tabela * 3) {
+    perfil__cresce(self);
+  }
+  return perfil__insere(self, pid, PC);
+}
+
+void perfil_conta_instrucao(perfil_t *self, int pid, int PC, int opcode)
+{
+  perfil_end_t *end = perfil__endereco(self, pid, PC);
+  end->opcode = opcode;
+  end->instrucoes++;
+  if (opcode >= 0 && opcode < N_OPCODE) self->por_opcode[opcode]++;
+  self->total_instrucoes++;
+}
+
+void perfil_conta_falta(perfil_t *self, int pid, int PC)
+{
+  perfil_end_t *end = perfil__endereco(self, pid, PC);
+  end->faltas++;
+  self->total_faltas++;
+}
+
+
+// ---------------------------------------------------------------------
+// SÍMBOLOS {{{1
+// ---------------------------------------------------------------------
+
+static int perfil__compara_simbolos(const void *a, const void *b)
+{
+  const simbolo_t *sa = a, *sb = b;
+  return sa->valor - sb->valor;
+}
+
+// lê o mapa de símbolos do programa, que tem o nome do programa com a
+//   extensão trocada para .sim e uma linha com valor e nome por símbolo
+static void perfil__le_simbolos(perfil_prog_t *prog)
+{
+  char nome[strlen(prog->nome_prog) + 5];
+  strcpy(nome, prog->nome_prog);
+  char *ponto = strrchr(nome, '.');
+  if (ponto != NULL) *ponto = '\0';
+  strcat(nome, ".sim");
+  FILE *arq = fopen(nome, "r");
+  if (arq == NULL) return;
+
+  int valor;
+  char simb[100];
+  while (fscanf(arq, "%d %99s", &valor, simb) == 2) {
+    prog->simbolos = realloc(prog->simbolos,
+                             (prog->n_simbolos + 1) * sizeof(*prog->simbolos));
+    assert(prog->simbolos != NULL);
+    prog->simbolos[prog->n_simbolos].valor = valor;
+    prog->simbolos[prog->n_simbolos].nome = strdup(simb);
+    prog->n_simbolos++;
+  }
+  fclose(arq);
+  qsort(prog->simbolos, prog->n_simbolos, sizeof(*prog->simbolos),
+        perfil__compara_simbolos);
+}
+
+// coloca em 'str' o símbolo mais próximo antes de 'PC' nos programas do
+//   processo 'pid' (como "símbolo+deslocamento"), ou "?" se não houver
+static void perfil__nome_endereco(perfil_t *self, int pid, int PC, char *str)
+{
+  simbolo_t *melhor = NULL;
+  for (int i = 0; i < self->n_programas; i++) {
+    perfil_prog_t *prog = &self->programas[i];
+    if (prog->pid != pid) continue;
+    for (int s = 0; s < prog->n_simbolos && prog->simbolos[s].valor <= PC; s++) {
+      if (melhor == NULL || prog->simbolos[s].valor >= melhor->valor) {
+        melhor = &prog->simbolos[s];
+      }
+    }
+  }
+  if (melhor == NULL) {
+    strcpy(str, "?");
+  } else if (melhor->valor == PC) {
+    sprintf(str, "%.90s", melhor->nome);
+  } else {
+    sprintf(str, "%.90s+%d", melhor->nome, PC - melhor->valor);
+  }
+}
+
+
+// ---------------------------------------------------------------------
+// RELATÓRIO {{{1
+// ---------------------------------------------------------------------
+
+static int perfil__compara_instrucoes(const void *a, const void *b)
+{
+  const perfil_end_t *ea = a, *eb = b;
+  if (ea->instrucoes != eb->instrucoes) return ea->instrucoes < eb->instrucoes ? 1 : -1;
+  if (ea->pid != eb->pid) return ea->pid - eb->pid;
+  return ea->PC - eb->PC;
+}
+
+static int perfil__compara_faltas(const void *a, const void *b)
+{
+  const perfil_end_t *ea = a, *eb = b;
+  if (ea->faltas != eb->faltas) return ea->faltas < eb->faltas ? 1 : -1;
+  if (ea->pid != eb->pid) return ea->pid - eb->pid;
+  return ea->PC - eb->PC;
+}
+
+static double perfil__pct(long n, long total)
+{
+  return total == 0 ? 0.0 : 100.0 * n / total;
+}
+
+bool perfil_grava(perfil_t *self, char *nome_arq)
+{
+  FILE *arq = fopen(nome_arq, "w");
+  if (arq == NULL) return false;
+
+  for (int i = 0; i < self->n_programas; i++) {
+    if (self->programas[i].simbolos == NULL) perfil__le_simbolos(&self->programas[i]);
+  }
+
+  fprintf(arq, "# perfil de execucao\n");
+  fprintf(arq, "# instrucoes executadas: %ld\n", self->total_instrucoes);
+  fprintf(arq, "# faltas de pagina: %ld\n", self->total_faltas);
+  fprintf(arq, "# pid %d: codigo executado em modo supervisor\n", PERFIL_PID_SO);
+
+  // instruções por opcode, da mais executada para a menos
+  fprintf(arq, "\n# instrucoes por opcode\n");
+  fprintf(arq, "# %-6s %12s %7s\n", "instr", "vezes", "%");
+  bool impresso[N_OPCODE] = { false };
+  for (;;) {
+    int maior = -1;
+    for (int op = 0; op < N_OPCODE; op++) {
+      if (impresso[op] || self->por_opcode[op] == 0) continue;
+      if (maior == -1 || self->por_opcode[op] > self->por_opcode[maior]) maior = op;
+    }
+    if (maior == -1) break;
+    impresso[maior] = true;
+    fprintf(arq, "  %-6s %12ld %6.2f%%\n", instrucao_nome(maior),
+            self->por_opcode[maior],
+            perfil__pct(self->por_opcode[maior], self->total_instrucoes));
+  }
+
+  // copia os endereços para um vetor, para ordenar
+  perfil_end_t *ends = malloc((self->n_enderecos + 1) * sizeof(*ends));
+  assert(ends != NULL);
+  int n = 0;
+  for (int i = 0; i < self->tam_tabela; i++) {
+    if (self->enderecos[i].usado) ends[n++] = self->enderecos[i];
+  }
+  char nome[100];
+
+  fprintf(arq, "\n# instrucoes por endereco\n");
+  fprintf(arq, "# %4s %5s %-6s %12s %7s %7s  %s\n",
+          "pid", "PC", "instr", "vezes", "%", "acum%", "simbolo");
+  qsort(ends, n, sizeof(*ends), perfil__compara_instrucoes);
+  long acumulado = 0;
+  for (int i = 0; i < n && ends[i].instrucoes > 0; i++) {
+    acumulado += ends[i].instrucoes;
+    perfil__nome_endereco(self, ends[i].pid, ends[i].PC, nome);
+    fprintf(arq, "  %4d %5d %-6s %12ld %6.2f%% %6.2f%%  %s\n",
+            ends[i].pid, ends[i].PC, instrucao_nome(ends[i].opcode),
+            ends[i].instrucoes, perfil__pct(ends[i].instrucoes, self->total_instrucoes),
+            perfil__pct(acumulado, self->total_instrucoes), nome);
+  }
+
+  fprintf(arq, "\n# faltas de pagina por endereco\n");
+  fprintf(arq, "# %4s %5s %12s %7s  %s\n", "pid", "PC", "faltas", "%", "simbolo");
+  qsort(ends, n, sizeof(*ends), perfil__compara_faltas);
+  for (int i = 0; i < n && ends[i].faltas > 0; i++) {
+    perfil__nome_endereco(self, ends[i].pid, ends[i].PC, nome);
+    fprintf(arq, "  %4d %5d %12ld %6.2f%%  %s\n",
+            ends[i].pid, ends[i].PC, ends[i].faltas,
+            perfil__pct(ends[i].faltas, self->total_faltas), nome);
+  }
+
+  free(ends);
+  fclose(arq);
+  return true;
+}
+
+// vim: foldmethod=marker
@@ -0,0 +1,44 @@
+// perfil.h
+// perfil de execução: instruções executadas e faltas de página por endereço
+// simulador de computador
+// so25b
+
+#ifndef PERFIL_H
+#define PERFIL_H
+
+#include <stdbool.h>
+
+// o perfil conta as instruções executadas por opcode e por endereço (virtual)
+//   em cada processo, e as faltas de página causadas em cada endereço
+// os processos são identificados pelo pid; o pid PERFIL_PID_SO identifica o
+//   código executado em modo supervisor (endereços físicos)
+// o relatório com os endereços mais executados mostra o símbolo mais próximo
+//   de cada endereço, se existir o mapa de símbolos do programa gerado pelo
+//   montador (o arquivo .sim de mesmo nome do .maq)
+
+#define PERFIL_PID_SO 0
+
+typedef struct perfil_t perfil_t;
+
+// cria um perfil vazio
+perfil_t *perfil_cria(void);
+
+// destrói o perfil
+void perfil_destroi(perfil_t *self);
+
+// informa que o processo 'pid' executa o programa do arquivo 'nome_prog'
+//   (usado para encontrar os símbolos); um pid pode ter mais de um programa
+void perfil_define_programa(perfil_t *self, int pid, char *nome_prog);
+
+// conta a execução da instrução 'opcode' no endereço 'PC' do processo 'pid'
+void perfil_conta_instrucao(perfil_t *self, int pid, int PC, int opcode);
+
+// conta uma falta de página causada pela instrução no endereço 'PC' do
+//   processo 'pid'
+void perfil_conta_falta(perfil_t *self, int pid, int PC);
+
+// grava o relatório do perfil no arquivo 'nome_arq'
+// retorna false se não conseguir criar o arquivo
+bool perfil_grava(perfil_t *self, char *nome_arq);
+
+#endif // PERFIL_H
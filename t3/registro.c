@@ -0,0 +1,191 @@
+// registro.c
+// gravação e reprodução das entradas não determinísticas da simulação
+// simulador de computador
+// so25b
+
+#include "registro.h"
+#include "console.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// formato do arquivo: uma linha de cabeçalho, seguida de uma linha por
+//   entrada, na ordem em que foram obtidas:
+//   T <leitura do teclado> <instruções> <código da tecla>
+//   R <instruções> <tempo real>
+#define REGISTRO_CABECALHO "//REG 1"
+
+// uma entrada gravada
+typedef struct {
+  int momento;     // número da leitura do teclado (só para teclas)
+  int instrucoes;  // número de instruções executadas quando foi obtida
+  int valor;       // a tecla ou o tempo real
+} registro_entrada_t;
+
+// uma sequência de entradas de um tipo, lidas do arquivo
+typedef struct {
+  int n;
+  int prox;        // próxima a entregar
+  registro_entrada_t *v;
+} registro_seq_t;
+
+struct registro_t {
+  registro_modo_t modo;
+  FILE *arq;
+  relogio_t *relogio;
+  // número de leituras do teclado já feitas
+  int leituras;
+  // na reprodução, as entradas lidas do arquivo
+  registro_seq_t teclas;
+  registro_seq_t tempos;
+  // já foi avisada uma divergência na reprodução
+  bool divergiu;
+};
+
+static void registro__insere(registro_seq_t *seq, int momento, int instrucoes, int valor)
+{
+  seq->v = realloc(seq->v, (seq->n + 1) * sizeof(*seq->v));
+  assert(seq->v != NULL);
+  seq->v[seq->n].momento = momento;
+  seq->v[seq->n].instrucoes = instrucoes;
+  seq->v[seq->n].valor = valor;
+  seq->n++;
+}
+
+// lê todas as entradas do arquivo; retorna false se o arquivo não for válido
+static bool registro__le_arquivo(registro_t *self)
+{
+  char linha[100];
+  if (fgets(linha, sizeof(linha), self->arq) == NULL) return false;
+  if (strncmp(linha, REGISTRO_CABECALHO, sizeof(REGISTRO_CABECALHO) - 1) != 0) {
+    return false;
+  }
+  while (fgets(linha, sizeof(linha), self->arq) != NULL) {
+    int momento, instrucoes, valor;
+    if (sscanf(linha, "T %d %d %d", &momento, &instrucoes, &valor) == 3) {
+      registro__insere(&self->teclas, momento, instrucoes, valor);
+    } else if (sscanf(linha, "R %d %d", &instrucoes, &valor) == 2) {
+      registro__insere(&self->tempos, 0, instrucoes, valor);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+registro_t *registro_cria(registro_modo_t modo, char *nome_arq, relogio_t *relogio)
+{
+  registro_t *self = malloc(sizeof(*self));
+  assert(self != NULL);
+
+  self->modo = modo;
+  self->arq = NULL;
+  self->relogio = relogio;
+  self->leituras = 0;
+  self->teclas = (registro_seq_t){ 0, 0, NULL };
+  self->tempos = (registro_seq_t){ 0, 0, NULL };
+  self->divergiu = false;
+
+  if (modo == REG_GRAVA) {
+    self->arq = fopen(nome_arq, "w");
+    if (self->arq != NULL) fprintf(self->arq, "%s\n", REGISTRO_CABECALHO);
+  } else if (modo == REG_REPRODUZ) {
+    self->arq = fopen(nome_arq, "r");
+    if (self->arq != NULL && !registro__le_arquivo(self)) {
+      fclose(self->arq);
+      self->arq = NULL;
+    }
+  }
+  if (modo != REG_DESLIGADO && self->arq == NULL) {
+    registro_destroi(self);
+    return NULL;
+  }
+
+  return self;
+}
+
+void registro_destroi(registro_t *self)
+{
+  if (self->arq != NULL) fclose(self->arq);
+  free(self->teclas.v);
+  free(self->tempos.v);
+  free(self);
+}
+
+registro_modo_t registro_modo(registro_t *self)
+{
+  return self->modo;
+}
+
+// número de instruções executadas até agora
+static int registro__instrucoes(registro_t *self)
+{
+  int instrucoes;
+  relogio_leitura(self->relogio, 0, &instrucoes);
+  return instrucoes;
+}
+
+// na reprodução, verifica se a entrada foi obtida no mesmo ponto da execução
+//   em que foi gravada
+static void registro__verifica(registro_t *self, registro_entrada_t *entrada)
+{
+  int instrucoes = registro__instrucoes(self);
+  if (entrada->instrucoes != instrucoes && !self->divergiu) {
+    console_printf("REGISTRO: reprodução divergiu da gravação"
+                   " (instrução %d, gravado %d)", instrucoes, entrada->instrucoes);
+    self->divergiu = true;
+  }
+}
+
+char registro_tecla(registro_t *self, char tecla)
+{
+  int momento = self->leituras++;
+  switch (self->modo) {
+    case REG_DESLIGADO:
+      return tecla;
+    case REG_GRAVA:
+      if (tecla != 0) {
+        fprintf(self->arq, "T %d %d %d\n", momento, registro__instrucoes(self), tecla);
+      }
+      return tecla;
+    case REG_REPRODUZ:
+      break;
+  }
+  registro_seq_t *seq = &self->teclas;
+  if (seq->prox >= seq->n || seq->v[seq->prox].momento != momento) return 0;
+  registro_entrada_t *entrada = &seq->v[seq->prox++];
+  registro__verifica(self, entrada);
+  return entrada->valor;
+}
+
+bool registro_terminou(registro_t *self)
+{
+  return self->modo == REG_REPRODUZ && self->teclas.prox >= self->teclas.n;
+}
+
+err_t registro_leitura(void *disp, int id, int *pvalor)
+{
+  registro_t *self = disp;
+  if (id != 0) return ERR_END_INV;
+  if (self->modo == REG_REPRODUZ) {
+    registro_seq_t *seq = &self->tempos;
+    if (seq->prox < seq->n) {
+      registro_entrada_t *entrada = &seq->v[seq->prox++];
+      registro__verifica(self, entrada);
+      *pvalor = entrada->valor;
+      return ERR_OK;
+    }
+    if (!self->divergiu) {
+      console_printf("REGISTRO: reprodução divergiu da gravação"
+                     " (leitura do tempo real não gravada)");
+      self->divergiu = true;
+    }
+  }
+  err_t err = relogio_leitura(self->relogio, 1, pvalor);
+  if (err == ERR_OK && self->modo == REG_GRAVA) {
+    fprintf(self->arq, "R %d %d\n", registro__instrucoes(self), *pvalor);
+  }
+  return err;
+}
@@ -0,0 +1,65 @@
+// registro.h
+// gravação e reprodução das entradas não determinísticas da simulação
+// simulador de computador
+// so25b
+
+#ifndef REGISTRO_H
+#define REGISTRO_H
+
+// o que a simulação recebe de fora, e que pode ser diferente a cada
+//   execução, é:
+// - as teclas digitadas na console (comandos do operador e entrada dos
+//   terminais), e o momento em que são lidas
+// - o tempo real, lido no dispositivo D_RELOGIO_REAL
+// em modo de gravação, o registro guarda esses valores em um arquivo, com o
+//   número de instruções executadas até o momento em que foram obtidos
+// em modo de reprodução, os valores são lidos do arquivo e entregues à
+//   simulação nos mesmos momentos, o que faz com que ela se repita
+//   exatamente; a reprodução não usa a tela nem o teclado
+//
+// uma tecla é identificada pela ordem da leitura do teclado em que foi
+//   obtida (a console lê o teclado um número determinado de vezes em cada
+//   volta do laço do controlador); o número de instruções é gravado para
+//   detectar divergências na reprodução (quando o programa ou o simulador
+//   foram alterados depois da gravação)
+
+#include <stdbool.h>
+#include "err.h"
+#include "relogio.h"
+
+typedef struct registro_t registro_t;
+
+typedef enum {
+  REG_DESLIGADO,  // as entradas não são gravadas nem reproduzidas
+  REG_GRAVA,      // as entradas são gravadas no arquivo
+  REG_REPRODUZ,   // as entradas são lidas do arquivo
+} registro_modo_t;
+
+// cria um registro no modo 'modo', usando o arquivo 'nome_arq' (ignorado
+//   no modo REG_DESLIGADO), e o relógio 'relogio' para saber o número de
+//   instruções executadas
+// retorna NULL se não for possível abrir o arquivo
+registro_t *registro_cria(registro_modo_t modo, char *nome_arq, relogio_t *relogio);
+
+// destrói o registro, fechando o arquivo
+void registro_destroi(registro_t *self);
+
+// retorna o modo do registro
+registro_modo_t registro_modo(registro_t *self);
+
+// deve ser chamada a cada leitura do teclado, com a tecla lida (ou 0 se não
+//   houver); retorna a tecla a usar na simulação
+// na gravação, grava a tecla e a retorna; na reprodução, ignora 'tecla' e
+//   retorna a tecla gravada para esta leitura, ou 0
+char registro_tecla(registro_t *self, char tecla);
+
+// retorna true se a reprodução chegou ao final do arquivo (não há mais
+//   teclas a entregar)
+bool registro_terminou(registro_t *self);
+
+// função para ler o tempo real como dispositivo de E/S, passando por este
+//   registro (ver relogio_leitura, id 1); segue o protocolo f_leitura_t de es.h
+// o único id válido é 0
+err_t registro_leitura(void *disp, int id, int *pvalor);
+
+#endif // REGISTRO_H
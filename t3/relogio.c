@@ -26,10 +26,19 @@ relogio_t *relogio_cria(void)
   assert(self != NULL);
 
   self->agora = 0;
+  self->t_ate_interrupcao = 0;
+  self->interrupcao_ativa = false;
 
   return self;
 }
 
+void relogio_snapshot(relogio_t *self, snapshot_t *snap)
+{
+  snapshot_int(snap, &self->agora);
+  snapshot_int(snap, &self->t_ate_interrupcao);
+  snapshot_bool(snap, &self->interrupcao_ativa);
+}
+
 void relogio_destroi(relogio_t *self)
 {
   free(self);
@@ -47,6 +56,20 @@ void relogio_tictac(relogio_t *self)
   }
 }
 
+void relogio_avanca(relogio_t *self, int n)
+{
+  if (n <= 0) return;
+  self->agora += n;
+  if (self->t_ate_interrupcao != 0) {
+    if (self->t_ate_interrupcao > n) {
+      self->t_ate_interrupcao -= n;
+    } else {
+      self->t_ate_interrupcao = 0;
+      self->interrupcao_ativa = true;
+    }
+  }
+}
+
 err_t relogio_leitura(void *disp, int id, int *pvalor)
 {
   relogio_t *self = disp;
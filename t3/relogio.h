@@ -22,6 +22,7 @@
 //   dispositivo
 
 #include "err.h"
+#include "snapshot.h"
 
 typedef struct relogio_t relogio_t;
 
@@ -36,6 +37,13 @@ void relogio_destroi(relogio_t *self);
 // esta função é chamada pelo controlador após a execução de cada instrução
 void relogio_tictac(relogio_t *self);
 
+// registra a passagem de n unidades de tempo de uma vez (o mesmo que chamar
+//   tictac n vezes)
+void relogio_avanca(relogio_t *self, int n);
+
+// salva ou carrega o estado do relógio (ver snapshot.h)
+void relogio_snapshot(relogio_t *self, snapshot_t *snap);
+
 // Funções para acessar o relógio como dispositivo de E/S, com id:
 //   '0' para ler o relógio local (contador de instruções)
 //   '1' para ler o tempo de CPU consumido pelo simulador (em ms)
@@ -0,0 +1,184 @@
+// snapshot.c
+// arquivo com uma cópia do estado da máquina simulada
+// simulador de computador
+// so25b
+
+#include "snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+
+// identificação do arquivo e da versão do formato
+#define SNAPSHOT_MAGICO 0x534e4150  // "SNAP"
+#define SNAPSHOT_VERSAO 10
+
+struct snapshot_t {
+  FILE *arq;
+  bool carregando;
+  bool ok;
+};
+
+// ---------------------------------------------------------------------
+// CODIFICAÇÃO {{{1
+// ---------------------------------------------------------------------
+
+// os inteiros são convertidos para sem sinal intercalando negativos e
+//   positivos (0, -1, 1, -2, ...), e gravados 7 bits por byte, do menos
+//   significativo para o mais; o bit 8 indica que tem mais bytes
+
+static void snapshot__escreve(snapshot_t *self, long valor)
+{
+  unsigned long v = ((unsigned long)valor << 1) ^ -(unsigned long)(valor < 0);
+  do {
+    int byte = v & 0x7f;
+    v >>= 7;
+    if (v != 0) byte |= 0x80;
+    if (putc(byte, self->arq) == EOF) self->ok = false;
+  } while (v != 0);
+}
+
+static long snapshot__le(snapshot_t *self)
+{
+  unsigned long v = 0;
+  int desl = 0;
+  int byte;
+  do {
+    byte = getc(self->arq);
+    if (byte == EOF || desl >= (int)sizeof(v) * CHAR_BIT) {
+      self->ok = false;
+      return 0;
+    }
+    v |= (unsigned long)(byte & 0x7f) << desl;
+    desl += 7;
+  } while (byte & 0x80);
+  return (long)(v >> 1) ^ -(long)(v & 1);
+}
+
+// salva ou carrega um valor entre 'min' e 'max'
+static long snapshot__valor(snapshot_t *self, long valor, long min, long max)
+{
+  if (!self->ok) return valor;
+  if (!self->carregando) {
+    snapshot__escreve(self, valor);
+    return valor;
+  }
+  long lido = snapshot__le(self);
+  if (lido < min || lido > max) {
+    self->ok = false;
+    return valor;
+  }
+  return lido;
+}
+
+
+// ---------------------------------------------------------------------
+// ABERTURA {{{1
+// ---------------------------------------------------------------------
+
+snapshot_t *snapshot_abre(char *nome_arq, bool carregando)
+{
+  FILE *arq = fopen(nome_arq, carregando ? "rb" : "wb");
+  if (arq == NULL) return NULL;
+
+  snapshot_t *self = malloc(sizeof(*self));
+  assert(self != NULL);
+  self->arq = arq;
+  self->carregando = carregando;
+  self->ok = true;
+
+  snapshot_confere(self, SNAPSHOT_MAGICO);
+  snapshot_confere(self, SNAPSHOT_VERSAO);
+  if (!self->ok) {
+    snapshot_fecha(self);
+    return NULL;
+  }
+  return self;
+}
+
+bool snapshot_fecha(snapshot_t *self)
+{
+  bool ok = self->ok;
+  if (fclose(self->arq) != 0) ok = false;
+  free(self);
+  return ok;
+}
+
+bool snapshot_carregando(snapshot_t *self)
+{
+  return self->carregando;
+}
+
+bool snapshot_ok(snapshot_t *self)
+{
+  return self->ok;
+}
+
+void snapshot_erro(snapshot_t *self)
+{
+  self->ok = false;
+}
+
+
+// ---------------------------------------------------------------------
+// VALORES {{{1
+// ---------------------------------------------------------------------
+
+void snapshot_int(snapshot_t *self, int *pvalor)
+{
+  *pvalor = snapshot__valor(self, *pvalor, -2147483647L - 1, 2147483647L);
+}
+
+void snapshot_long(snapshot_t *self, long *pvalor)
+{
+  *pvalor = snapshot__valor(self, *pvalor, -9223372036854775807L - 1, 9223372036854775807L);
+}
+
+void snapshot_unsigned(snapshot_t *self, unsigned *pvalor)
+{
+  *pvalor = snapshot__valor(self, *pvalor, 0, 4294967295L);
+}
+
+void snapshot_bool(snapshot_t *self, bool *pvalor)
+{
+  *pvalor = snapshot__valor(self, *pvalor, 0, 1);
+}
+
+void snapshot_vetor(snapshot_t *self, int n, int *v)
+{
+  for (int i = 0; i < n && self->ok; i++) {
+    snapshot_int(self, &v[i]);
+  }
+}
+
+void snapshot_bytes(snapshot_t *self, int n, void *p)
+{
+  if (!self->ok) return;
+  size_t feito;
+  if (self->carregando) {
+    feito = fread(p, 1, n, self->arq);
+  } else {
+    feito = fwrite(p, 1, n, self->arq);
+  }
+  if (feito != (size_t)n) self->ok = false;
+}
+
+void snapshot_str(snapshot_t *self, int tam, char *str)
+{
+  int n = self->carregando ? 0 : strlen(str);
+  n = snapshot__valor(self, n, 0, tam - 1);
+  if (!self->ok) return;
+  snapshot_bytes(self, n, str);
+  if (self->carregando && self->ok) str[n] = '\0';
+}
+
+void snapshot_confere(snapshot_t *self, int valor)
+{
+  int lido = valor;
+  snapshot_int(self, &lido);
+  if (lido != valor) self->ok = false;
+}
+
+// vim: foldmethod=marker
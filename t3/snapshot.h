@@ -0,0 +1,64 @@
+// snapshot.h
+// arquivo com uma cópia do estado da máquina simulada
+// simulador de computador
+// so25b
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+
+// um snapshot é um arquivo binário com o estado de todos os componentes da
+//   máquina (inclusive o SO), que permite continuar a simulação depois, a
+//   partir do mesmo ponto
+// cada componente tem uma função X_snapshot(self, snap), que passa cada
+//   parte do seu estado pelas funções abaixo, sempre na mesma ordem; ao
+//   salvar, os valores são escritos no arquivo, ao carregar são lidos do
+//   arquivo e colocados nas variáveis -- a mesma função serve para as duas
+//   coisas
+// os inteiros são gravados com tamanho variável (valores pequenos ocupam um
+//   byte), o que deixa compactas as memórias, que são quase todas zeros
+// um erro (de E/S ou de conteúdo) é guardado no snapshot, e as operações
+//   seguintes não fazem nada
+
+typedef struct snapshot_t snapshot_t;
+
+// abre o arquivo 'nome_arq' para salvar (carregando == false) ou para
+//   carregar um snapshot
+// retorna NULL se não conseguir abrir o arquivo ou se ele não for um snapshot
+snapshot_t *snapshot_abre(char *nome_arq, bool carregando);
+
+// fecha o arquivo do snapshot
+// retorna false se houve algum erro no uso do snapshot
+bool snapshot_fecha(snapshot_t *self);
+
+// retorna true se o snapshot está sendo carregado, false se está sendo salvo
+bool snapshot_carregando(snapshot_t *self);
+
+// retorna false se houve algum erro no uso do snapshot
+bool snapshot_ok(snapshot_t *self);
+
+// registra um erro no snapshot (por exemplo, um valor inválido carregado)
+void snapshot_erro(snapshot_t *self);
+
+// salva ou carrega um valor
+void snapshot_int(snapshot_t *self, int *pvalor);
+void snapshot_long(snapshot_t *self, long *pvalor);
+void snapshot_unsigned(snapshot_t *self, unsigned *pvalor);
+void snapshot_bool(snapshot_t *self, bool *pvalor);
+
+// salva ou carrega um vetor de 'n' inteiros
+void snapshot_vetor(snapshot_t *self, int n, int *v);
+
+// salva ou carrega 'n' bytes, sem conversão
+void snapshot_bytes(snapshot_t *self, int n, void *p);
+
+// salva ou carrega uma string terminada por '\0', em um vetor com 'tam' bytes
+void snapshot_str(snapshot_t *self, int tam, char *str);
+
+// salva 'valor', ou ao carregar, confere se o valor no arquivo é igual a
+//   'valor' (registrando erro se não for); usado para identificar as
+//   partes do arquivo e para tamanhos que têm que ser os mesmos
+void snapshot_confere(snapshot_t *self, int valor);
+
+#endif // SNAPSHOT_H
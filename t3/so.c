@@ -13,13 +13,17 @@
 #include "err.h"
 #include "irq.h"
 #include "memoria.h"
+#include "perfil.h"
 #include "programa.h"
 #include "tabpag.h"
 #include "mmu.h"
+#include "heap.h"
+#include "traco.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdint.h>
 
 
 // ---------------------------------------------------------------------
@@ -29,31 +33,64 @@
 // --- CONFIGURAÇÃO DO ESCALONADOR ---
 #define ESCALONADOR_ROUND_ROBIN 1
 #define ESCALONADOR_PRIORIDADE  2
+#define ESCALONADOR_MLFQ        3
+#define ESCALONADOR_CFS         4
 
 
 
 // ESCALONADOR ATIVO ----- MUDE AQUI --------
 #define ESCALONADOR_ATIVO ESCALONADOR_ROUND_ROBIN
 // #define ESCALONADOR_ATIVO ESCALONADOR_PRIORIDADE
-
-
-
-// --- CONFIGURACAO DO ALGORITMO DE SUBSTITUICAO ---
-#define ALGORITMO_SUBST_FIFO 1
-#define ALGORITMO_SUBST_LRU  2
-
-// Mude o valor abaixo para ALGORITMO_SUBST_LRU para trocar
-#define ALGORITMO_SUBST_ATIVO ALGORITMO_SUBST_LRU
+// #define ESCALONADOR_ATIVO ESCALONADOR_MLFQ
+// #define ESCALONADOR_ATIVO ESCALONADOR_CFS
+
+// MLFQ: número de níveis, e de quanto em quanto tempo (em instruções) todos
+//   os processos voltam ao nível 0
+// o quantum no nível n é QUANTUM << n; quem usa o quantum todo desce um
+//   nível, quem bloqueia por E/S nos terminais sobe um
+#define N_NIVEIS_MLFQ 3
+#define MLFQ_PERIODO_PROMOCAO (50 * QUANTUM * INTERVALO_INTERRUPCAO)
+
+// CFS: cada processo tem um peso (ver SO_MUDA_PESO), e o tempo de CPU que
+//   recebe é proporcional a ele; o tempo virtual (vruntime) conta as
+//   instruções executadas multiplicadas por PESO_PADRAO / peso, em
+//   1/PESO_PADRAO de instrução
+// os processos prontos dividem CFS_LATENCIA interrupções do relógio, cada
+//   um com pelo menos CFS_FATIA_MINIMA; um processo que desbloqueia
+//   interrompe o que está executando se estiver mais que CFS_GRANULARIDADE
+//   atrás dele, e volta no máximo CFS_CREDITO_ESPERA atrás do menor
+#define PESO_PADRAO 1024
+#define PESO_MAXIMO (64 * PESO_PADRAO)
+#define CFS_LATENCIA (2 * QUANTUM)
+#define CFS_FATIA_MINIMA 2
+#define CFS_GRANULARIDADE ((long)CFS_FATIA_MINIMA * INTERVALO_INTERRUPCAO * PESO_PADRAO)
+#define CFS_CREDITO_ESPERA ((long)CFS_LATENCIA * INTERVALO_INTERRUPCAO * PESO_PADRAO / 2)
+
+
+
+// --- CONFIGURACAO DA SUBSTITUICAO DE PAGINAS ---
+// a politica e escolhida na inicializacao (opcao -s do simulador, ver
+// so_define_politica_subst); esta e usada se nenhuma for escolhida
+#define POLITICA_SUBST_PADRAO "lru"
+
+// WSClock: uma pagina nao acessada ha mais que isto (em instrucoes) esta fora
+// do conjunto de trabalho, e pode ser substituida
+#define WSCLOCK_TAU 1000
 
 // intervalo entre interrupções do relogio
 #define INTERVALO_INTERRUPCAO 20   // numero de instrucoes executadas entre duas interrupcoes de relogio
 
-// tamanho da tabela de processos
-#define MAX_PROCESSOS 10
+// tamanho inicial da tabela de processos; ela dobra quando enche
+#define PROCESSOS_INICIAL 10
 
 // quantum do escalonador: quantidade de interrupcoes relogio que um processo recebe a partir da execucao (eh resetado em cada execucao)
 #define QUANTUM 10
 
+// memoria secundaria (disco de troca): tamanho, em palavras, e arquivo do
+// hospedeiro onde fica o conteudo (que pode ser examinado depois da execucao)
+#define TAM_DISCO 65536
+#define ARQ_DISCO "disco_da_maquina"
+
 #define NENHUM_PROCESSO -1
 #define ALGUM_PROCESSO 0
 
@@ -93,8 +130,18 @@ typedef struct {
 
   // para a chamada de sistema SO_ESPERA_PROC
   int pid_esperado;             // pid do processo que este esta esperando
+  int idx_esperado;             // e o indice dele na tabela
+
+  // filas de espera dos processos bloqueados (ver so_trata_pendencias)
+  int prox_espera;              // proximo na mesma fila (-1 se e o ultimo)
+  int primeiro_esperando;       // primeiro dos que esperam este terminar (-1 se nenhum)
+  int prox_hash;                // proximo na mesma lista do espalhamento por pid
 
   float prioridade;             // prioridade do processo
+  int nivel_mlfq;               // nível no escalonador MLFQ
+  int prox_pronto;              // proximo na mesma fila do MLFQ (-1 se e o ultimo)
+  int peso;                     // peso no escalonador CFS
+  long vruntime;                // tempo virtual de execução, no CFS
   int tempo_inicio_execucao;     // tempo de inicio de execucao do processo
 
   // ---------METRICAS---------
@@ -126,53 +173,114 @@ typedef struct {
 
 } processo_t;
 
-struct so_t {
+// o estado do SO próprio de cada CPU (núcleo)
+typedef struct {
+  so_t *so;
   cpu_t *cpu;
-  mem_t *mem;
   mmu_t *mmu;
+  int processo_atual_idx;
+  // controle de quantum
+  int quantum_restante;
+  // processo que foi morto por outra CPU enquanto executava nesta, e deve
+  //   ser terminado na próxima interrupção (ou NENHUM_PROCESSO)
+  int processo_a_matar_idx;
+
+  // fila de processos prontos (guarda os indices da tabela de processos)
+  // cada núcleo tem a sua; um núcleo sem processos pega de outro
+  // é circular, com o tamanho da tabela de processos
+  int *fila_prontos;
+  int inicio_fila;
+  int fim_fila;
+  int n_prontos;
+  // no MLFQ, uma fila por nível, e os níveis com processos (bit n = nível n)
+  int mlfq_inicio[N_NIVEIS_MLFQ];
+  int mlfq_fim[N_NIVEIS_MLFQ];
+  unsigned mlfq_niveis_ocupados;
+} nucleo_t;
+
+// politica de substituicao de paginas: funcoes chamadas pelo SO quando um
+// quadro passa a conter uma pagina, quando deixa de conter (a pagina foi
+// substituida ou o processo morreu), a cada interrupcao do relogio (pode ser
+// NULL) e quando e preciso escolher o quadro a substituir (-1 se nao houver)
+typedef struct {
+  char *nome;
+  void (*quadro_alocado)(so_t *self, int quadro);
+  void (*quadro_liberado)(so_t *self, int quadro);
+  void (*tic)(so_t *self);
+  int (*escolhe_vitima)(so_t *self);
+} politica_subst_t;
+
+struct so_t {
+  mem_t *mem;
   es_t *es;
   console_t *console;
   bool erro_interno;
 
   mem_t *mem_secundaria;
-  int topo_uso_disco;
-
-  processo_t tabela_processos[MAX_PROCESSOS];
-  int processo_atual_idx;
+  // alocacao do disco, em blocos do tamanho de uma pagina; cada processo
+  // ocupa blocos consecutivos, a partir de end_disco
+  int n_blocos_disco;
+  bool *bloco_disco_ocupado;
+
+  // tabela de processos (ver so_aumenta_tabela_processos)
+  processo_t *tabela_processos;
+  int tam_tabela_processos;
+  heap_t *entradas_livres;      // indices das entradas livres, o menor primeiro
+  int *hash_pid;                // espalhamento pid -> indice, listas por prox_hash
+  int n_listas_hash;            // potencia de 2
+  int *desbloqueados;           // vetor auxiliar, do tamanho da tabela
   int proximo_pid;
 
-  // fila de processos prontos (guarda os indices da tabela de processos)
-  int fila_prontos[MAX_PROCESSOS];
-  int inicio_fila;
-  int fim_fila;
-  int n_prontos;
+  // processos bloqueados, separados pelo motivo do bloqueio
+  int espera_disp_inicio[N_DISPOSITIVOS]; // fila de cada dispositivo de E/S (-1 se vazia)
+  int espera_disp_fim[N_DISPOSITIVOS];
+  heap_t *espera_disco;         // esperando E/S de disco, o que termina antes primeiro
+
+  // as CPUs, e a que está sendo atendida pelo SO
+  nucleo_t nucleos[MAX_CPUS];
+  int n_nucleos;
+  nucleo_t *nucleo;
 
   //metricas do sistema
   int num_processos_criados;
   long tempo_ocioso;
   int cont_interrupcoes[N_IRQ];
   int num_preempcoes_total;
-
-  // controle de quantum
-  int quantum_restante;
+  int mlfq_ultima_promocao;     // quando os processos voltaram ao nível 0
+  heap_t *heap_prontos;         // escalonadores por prioridade e CFS: os processos prontos
+  long cfs_peso_prontos;        // CFS: soma dos pesos dos processos no heap
+  long cfs_vruntime_min;        // CFS: tempo virtual do último escolhido (só aumenta)
 
   // T3
   // gestão simples de memória física
-  int quadro_livre;
+  int quadro_livre;             // proximo quadro nunca usado
+  int *pilha_quadros_livres;    // quadros devolvidos por processos que morreram
+  int n_quadros_livres;         // quantos quadros estao na pilha
 
   long tempo_disco_livre; // Tempo global em que o disco ficara livre
 
   int max_quadros_fisicos;      // Quantidade total de quadros na RAM
+  int tam_pagina;               // Tamanho de pagina (e quadro), definido pela MMU
   int n_quadros_ocupados;       // Quantos quadros estao em uso
-  int *fila_quadros_fifo;       // Fila para o algoritmo FIFO (armazena n_quadro)
-  int inicio_fila_fifo;
-  int fim_fila_fifo;
+
+  // substituicao de paginas
+  const politica_subst_t *politica;
+  int num_substituicoes;
+  // quadros em uso, em uma lista circular na ordem em que foram alocados
+  // (FIFO e politicas de relogio); o primeiro e o mais antigo, e e onde
+  // esta o ponteiro do relogio
+  int *prox_quadro;
+  int *ant_quadro;
+  int primeiro_quadro;          // -1 se a lista esta vazia
+  long *ultimo_uso;             // WSClock: quando cada quadro foi acessado por ultimo
+  traco_t *traco;               // referencias as paginas, para comparar com o otimo (ou NULL)
 
   struct {
     int processo_idx;     // Indice do processo dono (-1 se livre)
     int pagina_virtual;   // Pagina virtual mapeada neste quadro
     unsigned int age;     // Contador de envelhecimento
   } *tabela_quadros_invertida;
+  heap_t *quadros_por_age;      // quadros em uso, o de menor 'age' primeiro (LRU)
 };
 
 // --- DECLARAÇÕES ANTECIPADAS (PROTÓTIPOS) ---
@@ -186,6 +294,10 @@ static int so_carrega_programa_na_memoria_fisica(so_t *self, programa_t *program
 static int so_carrega_programa_na_memoria_virtual(so_t *self, programa_t *programa, processo_t *processo, const char *nome_prog, int processo_idx);
 static bool so_copia_str_do_processo(so_t *self, int tam, char str[tam], int end_virt, int processo_idx);
 
+// Funções da tabela de processos
+static bool so_aumenta_tabela_processos(so_t *self, int tam);
+static void so_refaz_indices(so_t *self, int tam);
+
 // Funções do ciclo de tratamento de interrupção
 static void so_salva_estado_da_cpu(so_t *self);
 static void so_trata_irq(so_t *self, int irq);
@@ -206,17 +318,24 @@ static void so_chamada_escr(so_t *self);
 static void so_chamada_cria_proc(so_t *self);
 static void so_chamada_mata_proc(so_t *self);
 static void so_chamada_espera_proc(so_t *self);
+static void so_chamada_muda_peso(so_t *self);
+static void so_mata_processo(so_t *self, int idx_alvo);
 
 // --- NOVOS PROTOTIPOS T3 ---
 static void so_trata_falta_de_pagina(so_t *self);
 static int so_encontra_quadro_livre(so_t *self);
+static void so_libera_quadros_do_processo(so_t *self, int processo_idx);
+static int so_substitui_pagina(so_t *self, long *tempo_swap_out);
+static const politica_subst_t *so_procura_politica_subst(char *nome);
 static void so_carrega_pagina_do_disco(so_t *self, processo_t *p, int pagina_virtual, int quadro_destino);
+static void so_invalida_pagina_nas_tlbs(so_t *self, tabpag_t *tabpag, int pagina);
+static int so_aloca_disco(so_t *self, processo_t *p);
+static void so_libera_disco(so_t *self, processo_t *p);
 
-#if ESCALONADOR_ATIVO == ESCALONADOR_ROUND_ROBIN
-// Funções da fila (apenas se Round Robin estiver ativo)
+// Funções da fila de prontos (cada escalonador tem a sua)
 static void insere_fila_prontos(so_t *self, int processo_idx);
 static int remove_fila_prontos(so_t *self);
-#endif
+static void retira_da_fila_prontos(so_t *self, int processo_idx);
 
 // Função de relatório
 void so_gera_relatorio(so_t *self); 
@@ -237,52 +356,70 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu, es_t *es, console_t *console)
   so_t *self = malloc(sizeof(*self));
   if (self == NULL) return NULL;
 
-  self->cpu = cpu;
   self->mem = mem;
-  self->mmu = mmu;
   self->es = es;
   self->console = console;
   self->erro_interno = false;
   self->num_processos_criados = 0;
   self->tempo_ocioso = 0;
   self->num_preempcoes_total = 0;
+  self->mlfq_ultima_promocao = 0;
   for (int i = 0; i < N_IRQ; i++) {
     self->cont_interrupcoes[i] = 0;
   }
 
   // inicializa a tabela de processos
-  for (int i = 0; i < MAX_PROCESSOS; i++) {
-    self->tabela_processos[i].estado = TERMINADO; // marcar todos como livres/terminados
-    self->tabela_processos[i].pid = -1; // e deixar sem pid
+  self->n_nucleos = 0;
+  self->tabela_processos = NULL;
+  self->tam_tabela_processos = 0;
+  self->hash_pid = NULL;
+  self->n_listas_hash = 0;
+  self->desbloqueados = NULL;
+  self->entradas_livres = heap_cria(PROCESSOS_INICIAL);
+  self->espera_disco = heap_cria(PROCESSOS_INICIAL);
+  self->heap_prontos = heap_cria(PROCESSOS_INICIAL);
+  self->cfs_peso_prontos = 0;
+  self->cfs_vruntime_min = 0;
+  if (!so_aumenta_tabela_processos(self, PROCESSOS_INICIAL)) {
+    console_printf("SO: ERRO FATAL ao alocar a tabela de processos!");
+    self->erro_interno = true;
   }
-  self->processo_atual_idx = NENHUM_PROCESSO; // Nenhum processo executando inicialmente
   self->proximo_pid = 1;
+  for (int d = 0; d < N_DISPOSITIVOS; d++) {
+    self->espera_disp_inicio[d] = -1;
+    self->espera_disp_fim[d] = -1;
+  }
 
-  // Inicializa a fila de prontos
-  self->inicio_fila = 0;
-  self->fim_fila = 0;
-  self->n_prontos = 0;
-
-  // Inicializa o quantum
-  self->quantum_restante = 0;
+  // a primeira CPU; as outras são acrescentadas com so_adiciona_cpu
+  self->traco = NULL;
+  so_adiciona_cpu(self, cpu, mmu);
+  self->nucleo = &self->nucleos[0];
   
   // --- T3 ---
   // Inicializa o gestor de memória
   // O primeiro quadro livre é após a memória protegida pelo hardware
-  self->quadro_livre = CPU_END_FIM_PROT / TAM_PAGINA + 1;
+  self->tam_pagina = mmu_tam_pagina(mmu);
+  self->quadro_livre = mmu_pagina(mmu, CPU_END_FIM_PROT) + 1;
 
   self->tempo_disco_livre = 0; // Disco comeca livre
 
-  self->max_quadros_fisicos = mem_tam(self->mem) / TAM_PAGINA;
+  self->max_quadros_fisicos = mem_tam(self->mem) / self->tam_pagina;
   self->n_quadros_ocupados = 0;
-  self->inicio_fila_fifo = 0;
-  self->fim_fila_fifo = 0;
-
-  // Aloca a fila FIFO e a tabela invertida
-  self->fila_quadros_fifo = calloc(self->max_quadros_fisicos, sizeof(int));
+  self->politica = so_procura_politica_subst(POLITICA_SUBST_PADRAO);
+  self->num_substituicoes = 0;
+  self->primeiro_quadro = -1;
+
+  // Aloca as estruturas das politicas de substituicao e a tabela invertida
+  self->prox_quadro = calloc(self->max_quadros_fisicos, sizeof(int));
+  self->ant_quadro = calloc(self->max_quadros_fisicos, sizeof(int));
+  self->ultimo_uso = calloc(self->max_quadros_fisicos, sizeof(long));
   self->tabela_quadros_invertida = calloc(self->max_quadros_fisicos, sizeof(self->tabela_quadros_invertida[0]));
+  self->pilha_quadros_livres = calloc(self->max_quadros_fisicos, sizeof(int));
+  self->n_quadros_livres = 0;
+  self->quadros_por_age = heap_cria(self->max_quadros_fisicos);
 
-  if (self->fila_quadros_fifo == NULL || self->tabela_quadros_invertida == NULL) {
+  if (self->prox_quadro == NULL || self->ant_quadro == NULL || self->ultimo_uso == NULL
+      || self->tabela_quadros_invertida == NULL || self->pilha_quadros_livres == NULL) {
     console_printf("SO: ERRO FATAL ao alocar estruturas de paginacao!");
     self->erro_interno = true;
   } 
@@ -296,66 +433,608 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu, es_t *es, console_t *console)
   // O quadro 0 ate self->quadro_livre (SO, ROM, etc) ja estao ocupados
   self->n_quadros_ocupados = self->quadro_livre;
 
+  self->mem_secundaria = mem_cria_em_arquivo(TAM_DISCO, ARQ_DISCO);
+  if (self->mem_secundaria == NULL) {
+    console_printf("SO: nao foi possivel usar o arquivo '%s' como disco; usando memoria.", ARQ_DISCO);
+    self->mem_secundaria = mem_cria(TAM_DISCO);
+    mem_preenche(self->mem_secundaria, 0, TAM_DISCO, 0);
+  }
+  self->n_blocos_disco = TAM_DISCO / self->tam_pagina;
+  self->bloco_disco_ocupado = calloc(self->n_blocos_disco, sizeof(bool));
+  if (self->bloco_disco_ocupado == NULL) {
+    console_printf("SO: ERRO FATAL ao alocar estruturas do disco!");
+    self->erro_interno = true;
+  }
+
+  return self;
+}
+
+void so_adiciona_cpu(so_t *self, cpu_t *cpu, mmu_t *mmu)
+{
+  if (self->n_nucleos == MAX_CPUS) {
+    console_printf("SO: ERRO! CPUs demais.");
+    self->erro_interno = true;
+    return;
+  }
+  nucleo_t *nucleo = &self->nucleos[self->n_nucleos++];
+  nucleo->so = self;
+  nucleo->cpu = cpu;
+  nucleo->mmu = mmu;
+  mmu_define_traco(mmu, self->traco);
+  nucleo->processo_atual_idx = NENHUM_PROCESSO; // Nenhum processo executando inicialmente
+  nucleo->processo_a_matar_idx = NENHUM_PROCESSO;
+
+  // Inicializa a fila de prontos
+  nucleo->fila_prontos = malloc(self->tam_tabela_processos * sizeof(int));
+  if (nucleo->fila_prontos == NULL) {
+    console_printf("SO: ERRO FATAL ao alocar a fila de prontos!");
+    self->erro_interno = true;
+  }
+  nucleo->inicio_fila = 0;
+  nucleo->fim_fila = 0;
+  nucleo->n_prontos = 0;
+  for (int nivel = 0; nivel < N_NIVEIS_MLFQ; nivel++) {
+    nucleo->mlfq_inicio[nivel] = -1;
+    nucleo->mlfq_fim[nivel] = -1;
+  }
+  nucleo->mlfq_niveis_ocupados = 0;
+
+  // Inicializa o quantum
+  nucleo->quantum_restante = 0;
+
   // quando a CPU executar uma instrução CHAMAC, deve chamar a função
-  //   so_trata_interrupcao, com primeiro argumento um ptr para o SO
-  cpu_define_chamaC(self->cpu, so_trata_interrupcao, self);
+  //   so_trata_interrupcao, com primeiro argumento um ptr para o núcleo,
+  //   que identifica a CPU e tem um ptr para o SO
+  cpu_define_chamaC(cpu, so_trata_interrupcao, nucleo);
 
   // Desliga a MMU no início (sem tabela de páginas global)
-  mmu_define_tabpag(self->mmu, NULL);
+  mmu_define_tabpag(mmu, NULL);
+}
 
-  self->mem_secundaria = mem_cria(8192); 
-  self->topo_uso_disco = 0;
+bool so_define_politica_subst(so_t *self, char *nome)
+{
+  const politica_subst_t *politica = so_procura_politica_subst(nome);
+  if (politica == NULL) return false;
+  self->politica = politica;
+  return true;
+}
 
-  return self;
+void so_registra_traco(so_t *self)
+{
+  if (self->traco != NULL) return;
+  self->traco = traco_cria();
+  for (int c = 0; c < self->n_nucleos; c++) {
+    mmu_define_traco(self->nucleos[c].mmu, self->traco);
+  }
 }
 
 void so_destroi(so_t *self)
 {
-  cpu_define_chamaC(self->cpu, NULL, NULL);
+  for (int c = 0; c < self->n_nucleos; c++) {
+    cpu_define_chamaC(self->nucleos[c].cpu, NULL, NULL);
+    free(self->nucleos[c].fila_prontos);
+  }
 
   // Limpa as tabelas de páginas de processos que possam ter sobrado
-  for (int i = 0; i < MAX_PROCESSOS; i++) {
+  for (int i = 0; i < self->tam_tabela_processos; i++) {
     if (self->tabela_processos[i].tabpag != NULL) {
       tabpag_destroi(self->tabela_processos[i].tabpag);
     }
   }
-  free(self->fila_quadros_fifo);
+  free(self->tabela_processos);
+  free(self->hash_pid);
+  free(self->desbloqueados);
+  heap_destroi(self->entradas_livres);
+  free(self->prox_quadro);
+  free(self->ant_quadro);
+  free(self->ultimo_uso);
   free(self->tabela_quadros_invertida);
+  free(self->pilha_quadros_livres);
+  heap_destroi(self->quadros_por_age);
+  heap_destroi(self->espera_disco);
+  heap_destroi(self->heap_prontos);
+  if (self->traco != NULL) {
+    for (int c = 0; c < self->n_nucleos; c++) {
+      mmu_define_traco(self->nucleos[c].mmu, NULL);
+    }
+    traco_destroi(self->traco);
+  }
   
   if (self->mem_secundaria != NULL) {
     mem_destroi(self->mem_secundaria);
   }
+  free(self->bloco_disco_ocupado);
 
   free(self);
 }
 
-#if ESCALONADOR_ATIVO == ESCALONADOR_ROUND_ROBIN //devido a ter dois escalonadores
+
+// ---------------------------------------------------------------------
+// SNAPSHOT {{{1
+// ---------------------------------------------------------------------
+
+// salva ou carrega um valor de enum
+static void so__snapshot_enum(snapshot_t *snap, void *penum, int max)
+{
+  int valor = *(int *)penum;
+  snapshot_int(snap, &valor);
+  if (valor < 0 || valor > max) snapshot_erro(snap);
+  else *(int *)penum = valor;
+}
+
+static void so__snapshot_processo(processo_t *p, snapshot_t *snap)
+{
+  snapshot_int(snap, &p->pid);
+  so__snapshot_enum(snap, &p->estado, TERMINADO);
+  so__snapshot_enum(snap, &p->tipo_bloqueio, BLOQUEIO_PAGINACAO);
+  snapshot_int(snap, &p->regA);
+  snapshot_int(snap, &p->regX);
+  snapshot_int(snap, &p->regPC);
+  snapshot_int(snap, &p->regERRO);
+  snapshot_int(snap, &p->regComplemento);
+  so__snapshot_enum(snap, &p->disp_entrada, N_DISPOSITIVOS - 1);
+  so__snapshot_enum(snap, &p->disp_saida, N_DISPOSITIVOS - 1);
+  snapshot_int(snap, &p->pid_esperado);
+  snapshot_int(snap, &p->idx_esperado);
+  snapshot_int(snap, &p->prox_espera);
+  snapshot_int(snap, &p->primeiro_esperando);
+  snapshot_int(snap, &p->nivel_mlfq);
+  snapshot_int(snap, &p->prox_pronto);
+  snapshot_int(snap, &p->peso);
+  snapshot_long(snap, &p->vruntime);
+  snapshot_bytes(snap, sizeof(p->prioridade), &p->prioridade);
+  snapshot_int(snap, &p->tempo_inicio_execucao);
+  snapshot_int(snap, &p->tempo_criacao);
+  snapshot_int(snap, &p->tempo_termino);
+  snapshot_int(snap, &p->num_preempcoes);
+  snapshot_int(snap, &p->vezes_pronto);
+  snapshot_int(snap, &p->vezes_bloqueado);
+  snapshot_int(snap, &p->vezes_executando);
+  snapshot_long(snap, &p->tempo_total_pronto);
+  snapshot_long(snap, &p->tempo_total_bloqueado);
+  snapshot_long(snap, &p->tempo_total_executando);
+  snapshot_int(snap, &p->tempo_entrou_no_estado_atual);
+  snapshot_long(snap, &p->soma_tempo_resposta);
+  snapshot_int(snap, &p->n_respostas);
+  snapshot_int(snap, &p->tempo_desbloqueio);
+  snapshot_int(snap, &p->end_disco);
+  snapshot_str(snap, sizeof(p->nome_executavel), p->nome_executavel);
+  snapshot_int(snap, &p->tam_memoria);
+  snapshot_long(snap, &p->tempo_termino_io_disco);
+  snapshot_int(snap, &p->num_page_faults);
+
+  // a tabela de páginas é recriada ao carregar
+  bool tem_tabpag = p->tabpag != NULL;
+  snapshot_bool(snap, &tem_tabpag);
+  if (snapshot_carregando(snap)) {
+    tabpag_destroi(p->tabpag);
+    p->tabpag = tem_tabpag ? tabpag_cria() : NULL;
+  }
+  if (p->tabpag != NULL) tabpag_snapshot(p->tabpag, snap);
+}
+
+// retorna true se 'idx' é um índice de processo ou NENHUM_PROCESSO
+static bool so__idx_valido(so_t *self, int idx)
+{
+  return idx >= NENHUM_PROCESSO && idx < self->tam_tabela_processos;
+}
+
+static void so__snapshot_nucleo(so_t *self, nucleo_t *nucleo, snapshot_t *snap)
+{
+  snapshot_int(snap, &nucleo->processo_atual_idx);
+  snapshot_int(snap, &nucleo->quantum_restante);
+  snapshot_int(snap, &nucleo->processo_a_matar_idx);
+  snapshot_vetor(snap, self->tam_tabela_processos, nucleo->fila_prontos);
+  snapshot_int(snap, &nucleo->inicio_fila);
+  snapshot_int(snap, &nucleo->fim_fila);
+  snapshot_int(snap, &nucleo->n_prontos);
+  snapshot_confere(snap, N_NIVEIS_MLFQ);
+  snapshot_vetor(snap, N_NIVEIS_MLFQ, nucleo->mlfq_inicio);
+  snapshot_vetor(snap, N_NIVEIS_MLFQ, nucleo->mlfq_fim);
+  snapshot_unsigned(snap, &nucleo->mlfq_niveis_ocupados);
+
+  // a tabela em uso pela MMU (a de um processo, ou nenhuma)
+  int idx_mmu = NENHUM_PROCESSO;
+  for (int i = 0; i < self->tam_tabela_processos; i++) {
+    tabpag_t *tabpag = self->tabela_processos[i].tabpag;
+    if (tabpag != NULL && tabpag == mmu_tabpag(nucleo->mmu)) idx_mmu = i;
+  }
+  snapshot_int(snap, &idx_mmu);
+  if (!snapshot_carregando(snap) || !snapshot_ok(snap)) return;
+
+  if (!so__idx_valido(self, idx_mmu) || !so__idx_valido(self, nucleo->processo_atual_idx)
+      || !so__idx_valido(self, nucleo->processo_a_matar_idx)) {
+    snapshot_erro(snap);
+    return;
+  }
+  if (idx_mmu == NENHUM_PROCESSO) {
+    mmu_define_tabpag(nucleo->mmu, NULL);
+  } else {
+    mmu_define_tabpag(nucleo->mmu, self->tabela_processos[idx_mmu].tabpag);
+  }
+  if (nucleo->processo_atual_idx != NENHUM_PROCESSO) {
+    processo_t *p = &self->tabela_processos[nucleo->processo_atual_idx];
+    cpu_define_processo(nucleo->cpu, p->pid, p->nome_executavel);
+  }
+}
+
+void so_snapshot(so_t *self, snapshot_t *snap)
+{
+  snapshot_bool(snap, &self->erro_interno);
+  snapshot_int(snap, &self->proximo_pid);
+  snapshot_int(snap, &self->num_processos_criados);
+  snapshot_long(snap, &self->tempo_ocioso);
+  snapshot_confere(snap, N_IRQ);
+  snapshot_vetor(snap, N_IRQ, self->cont_interrupcoes);
+  snapshot_int(snap, &self->num_preempcoes_total);
+  snapshot_int(snap, &self->mlfq_ultima_promocao);
+  snapshot_long(snap, &self->cfs_vruntime_min);
+
+  // a tabela de processos; o carregamento aumenta a tabela se o snapshot
+  //   tiver mais entradas
+  int tam = self->tam_tabela_processos;
+  snapshot_int(snap, &tam);
+  if (snapshot_carregando(snap) && tam != self->tam_tabela_processos) {
+    if (tam < self->tam_tabela_processos || !so_aumenta_tabela_processos(self, tam)) {
+      snapshot_erro(snap);
+      return;
+    }
+  }
+  for (int i = 0; i < self->tam_tabela_processos; i++) {
+    so__snapshot_processo(&self->tabela_processos[i], snap);
+  }
+  if (snapshot_carregando(snap)) {
+    so_refaz_indices(self, self->tam_tabela_processos);
+    #if ESCALONADOR_ATIVO == ESCALONADOR_PRIORIDADE || ESCALONADOR_ATIVO == ESCALONADOR_CFS
+    // entre interrupções, os processos prontos são os do heap
+    heap_esvazia(self->heap_prontos);
+    self->cfs_peso_prontos = 0;
+    for (int i = 0; i < self->tam_tabela_processos; i++) {
+      if (self->tabela_processos[i].estado == PRONTO) insere_fila_prontos(self, i);
+    }
+    #endif
+  }
+  snapshot_confere(snap, N_DISPOSITIVOS);
+  snapshot_vetor(snap, N_DISPOSITIVOS, self->espera_disp_inicio);
+  snapshot_vetor(snap, N_DISPOSITIVOS, self->espera_disp_fim);
+  if (snapshot_carregando(snap)) {
+    // o heap e refeito a partir dos processos
+    heap_esvazia(self->espera_disco);
+    for (int i = 0; i < self->tam_tabela_processos; i++) {
+      processo_t *p = &self->tabela_processos[i];
+      if (p->estado == BLOQUEADO && p->tipo_bloqueio == BLOQUEIO_PAGINACAO) {
+        heap_insere(self->espera_disco, i, p->tempo_termino_io_disco);
+      }
+    }
+  }
+
+  // memória física
+  snapshot_int(snap, &self->quadro_livre);
+  snapshot_confere(snap, self->max_quadros_fisicos);
+  snapshot_int(snap, &self->n_quadros_livres);
+  snapshot_vetor(snap, self->max_quadros_fisicos, self->pilha_quadros_livres);
+  snapshot_int(snap, &self->n_quadros_ocupados);
+
+  // substituição de páginas; a política é identificada pelo nome
+  char nome_politica[20];
+  strcpy(nome_politica, self->politica->nome);
+  snapshot_str(snap, sizeof(nome_politica), nome_politica);
+  if (snapshot_carregando(snap)) {
+    const politica_subst_t *politica = so_procura_politica_subst(nome_politica);
+    if (politica == NULL) {
+      snapshot_erro(snap);
+    } else {
+      self->politica = politica;
+    }
+  }
+  snapshot_int(snap, &self->num_substituicoes);
+  snapshot_vetor(snap, self->max_quadros_fisicos, self->prox_quadro);
+  snapshot_vetor(snap, self->max_quadros_fisicos, self->ant_quadro);
+  snapshot_int(snap, &self->primeiro_quadro);
+  for (int q = 0; q < self->max_quadros_fisicos; q++) {
+    snapshot_long(snap, &self->ultimo_uso[q]);
+  }
+  for (int q = 0; q < self->max_quadros_fisicos; q++) {
+    snapshot_int(snap, &self->tabela_quadros_invertida[q].processo_idx);
+    snapshot_int(snap, &self->tabela_quadros_invertida[q].pagina_virtual);
+    snapshot_unsigned(snap, &self->tabela_quadros_invertida[q].age);
+  }
+  if (snapshot_carregando(snap)) {
+    // o heap e refeito a partir da tabela invertida
+    heap_esvazia(self->quadros_por_age);
+    for (int q = 0; q < self->max_quadros_fisicos; q++) {
+      if (self->tabela_quadros_invertida[q].processo_idx != -1) {
+        heap_insere(self->quadros_por_age, q, self->tabela_quadros_invertida[q].age);
+      }
+    }
+  }
+
+  // memória secundária
+  mem_snapshot(self->mem_secundaria, snap);
+  snapshot_confere(snap, self->n_blocos_disco);
+  for (int b = 0; b < self->n_blocos_disco; b++) {
+    snapshot_bool(snap, &self->bloco_disco_ocupado[b]);
+  }
+  snapshot_long(snap, &self->tempo_disco_livre);
+
+  // o estado de cada CPU; o snapshot tem que ser carregado em uma máquina
+  //   com o mesmo número de CPUs
+  snapshot_confere(snap, self->n_nucleos);
+  for (int c = 0; c < self->n_nucleos; c++) {
+    so__snapshot_nucleo(self, &self->nucleos[c], snap);
+  }
+}
+
+#if ESCALONADOR_ATIVO == ESCALONADOR_ROUND_ROBIN //cada escalonador tem a sua fila
 
 // --- FUNÇÕES NOVAS PARA A FILA ---
 // Insere um processo (pelo seu índice na tabela) no fim da fila de prontos
 static void insere_fila_prontos(so_t *self, int processo_idx)
 {
-  if (self->n_prontos == MAX_PROCESSOS) {
+  if (self->nucleo->n_prontos == self->tam_tabela_processos) {
     console_printf("SO: ERRO! Fila de prontos cheia.");
     return;
   }
-  self->fila_prontos[self->fim_fila] = processo_idx;
-  self->fim_fila = (self->fim_fila + 1) % MAX_PROCESSOS;
-  self->n_prontos++;
+  self->nucleo->fila_prontos[self->nucleo->fim_fila] = processo_idx;
+  self->nucleo->fim_fila = (self->nucleo->fim_fila + 1) % self->tam_tabela_processos;
+  self->nucleo->n_prontos++;
 }
 
 // Remove e retorna o processo do início da fila de prontos
+// se a fila do núcleo atual estiver vazia, pega o primeiro da fila mais
+//   longa entre as dos outros núcleos
+static int remove_fila_prontos(so_t *self)
+{
+  nucleo_t *nucleo = self->nucleo;
+  if (nucleo->n_prontos == 0) {
+    for (int c = 0; c < self->n_nucleos; c++) {
+      if (self->nucleos[c].n_prontos > nucleo->n_prontos) {
+        nucleo = &self->nucleos[c];
+      }
+    }
+  }
+  if (nucleo->n_prontos == 0) {
+    return -1; // Fila vazia
+  }
+  int processo_idx = nucleo->fila_prontos[nucleo->inicio_fila];
+  nucleo->inicio_fila = (nucleo->inicio_fila + 1) % self->tam_tabela_processos;
+  nucleo->n_prontos--;
+  return processo_idx;
+}
+
+// Tira um processo da fila de prontos em que ele estiver (um processo morto
+//   enquanto espera a vez); não faz nada se ele não estiver em nenhuma (o
+//   que estava executando ainda não voltou para a fila)
+static void retira_da_fila_prontos(so_t *self, int processo_idx)
+{
+  int tam = self->tam_tabela_processos;
+  for (int c = 0; c < self->n_nucleos; c++) {
+    nucleo_t *nucleo = &self->nucleos[c];
+    for (int k = 0; k < nucleo->n_prontos; k++) {
+      int pos = (nucleo->inicio_fila + k) % tam;
+      if (nucleo->fila_prontos[pos] != processo_idx) continue;
+      // os que estão atrás dele andam uma posição
+      for (; k < nucleo->n_prontos - 1; k++) {
+        int prox = (pos + 1) % tam;
+        nucleo->fila_prontos[pos] = nucleo->fila_prontos[prox];
+        pos = prox;
+      }
+      nucleo->fim_fila = pos;
+      nucleo->n_prontos--;
+      return;
+    }
+  }
+}
+
+#elif ESCALONADOR_ATIVO == ESCALONADOR_MLFQ
+
+// MLFQ: cada núcleo tem uma fila por nível, encadeada por prox_pronto, e um
+//   mapa de bits dos níveis com processos; o nível 0 é o mais prioritário
+
+// Insere um processo no fim da fila do nível dele
+static void insere_fila_prontos(so_t *self, int processo_idx)
+{
+  nucleo_t *nucleo = self->nucleo;
+  processo_t *p = &self->tabela_processos[processo_idx];
+  int nivel = p->nivel_mlfq;
+  p->prox_pronto = -1;
+  if (nucleo->mlfq_inicio[nivel] == -1) {
+    nucleo->mlfq_inicio[nivel] = processo_idx;
+  } else {
+    self->tabela_processos[nucleo->mlfq_fim[nivel]].prox_pronto = processo_idx;
+  }
+  nucleo->mlfq_fim[nivel] = processo_idx;
+  nucleo->mlfq_niveis_ocupados |= 1u << nivel;
+  nucleo->n_prontos++;
+}
+
+// o nível mais prioritário com processos prontos, ou N_NIVEIS_MLFQ se não há
+static int so__mlfq_nivel_mais_alto(nucleo_t *nucleo)
+{
+  if (nucleo->mlfq_niveis_ocupados == 0) return N_NIVEIS_MLFQ;
+  return __builtin_ctz(nucleo->mlfq_niveis_ocupados);
+}
+
+// Remove e retorna o primeiro processo do nível mais prioritário
+// se o núcleo atual não tiver processos prontos, pega do núcleo que tiver mais
 static int remove_fila_prontos(so_t *self)
 {
-  if (self->n_prontos == 0) {
+  nucleo_t *nucleo = self->nucleo;
+  if (nucleo->n_prontos == 0) {
+    for (int c = 0; c < self->n_nucleos; c++) {
+      if (self->nucleos[c].n_prontos > nucleo->n_prontos) {
+        nucleo = &self->nucleos[c];
+      }
+    }
+  }
+  if (nucleo->n_prontos == 0) {
     return -1; // Fila vazia
   }
-  int processo_idx = self->fila_prontos[self->inicio_fila];
-  self->inicio_fila = (self->inicio_fila + 1) % MAX_PROCESSOS;
-  self->n_prontos--;
+  int nivel = so__mlfq_nivel_mais_alto(nucleo);
+  int processo_idx = nucleo->mlfq_inicio[nivel];
+  nucleo->mlfq_inicio[nivel] = self->tabela_processos[processo_idx].prox_pronto;
+  if (nucleo->mlfq_inicio[nivel] == -1) {
+    nucleo->mlfq_niveis_ocupados &= ~(1u << nivel);
+  }
+  nucleo->n_prontos--;
   return processo_idx;
 }
 
+// Tira um processo da fila do nível dele, no núcleo em que estiver; não faz
+//   nada se ele não estiver em nenhuma
+static void retira_da_fila_prontos(so_t *self, int processo_idx)
+{
+  processo_t *p = &self->tabela_processos[processo_idx];
+  int nivel = p->nivel_mlfq;
+  for (int c = 0; c < self->n_nucleos; c++) {
+    nucleo_t *nucleo = &self->nucleos[c];
+    int ant = -1;
+    for (int i = nucleo->mlfq_inicio[nivel]; i != -1; i = self->tabela_processos[i].prox_pronto) {
+      if (i != processo_idx) {
+        ant = i;
+        continue;
+      }
+      if (ant == -1) {
+        nucleo->mlfq_inicio[nivel] = p->prox_pronto;
+      } else {
+        self->tabela_processos[ant].prox_pronto = p->prox_pronto;
+      }
+      if (nucleo->mlfq_fim[nivel] == processo_idx) {
+        nucleo->mlfq_fim[nivel] = ant;
+      }
+      if (nucleo->mlfq_inicio[nivel] == -1) {
+        nucleo->mlfq_niveis_ocupados &= ~(1u << nivel);
+      }
+      p->prox_pronto = -1;
+      nucleo->n_prontos--;
+      return;
+    }
+  }
+}
+
+// de tempos em tempos todos os processos voltam ao nível mais prioritário,
+//   para os que desceram não ficarem sem executar
+static void so_mlfq_promove_todos(so_t *self)
+{
+  int tempo_agora;
+  es_le(self->es, D_RELOGIO_INSTRUCOES, &tempo_agora);
+  if (tempo_agora - self->mlfq_ultima_promocao < MLFQ_PERIODO_PROMOCAO) return;
+  self->mlfq_ultima_promocao = tempo_agora;
+  console_printf("SO: MLFQ: todos os processos voltam ao nivel 0.");
+
+  for (int i = 0; i < self->tam_tabela_processos; i++) {
+    self->tabela_processos[i].nivel_mlfq = 0;
+  }
+  // as filas dos outros níveis vão para o fim da do nível 0, em ordem
+  for (int c = 0; c < self->n_nucleos; c++) {
+    nucleo_t *nucleo = &self->nucleos[c];
+    for (int nivel = 1; nivel < N_NIVEIS_MLFQ; nivel++) {
+      if (nucleo->mlfq_inicio[nivel] == -1) continue;
+      if (nucleo->mlfq_inicio[0] == -1) {
+        nucleo->mlfq_inicio[0] = nucleo->mlfq_inicio[nivel];
+      } else {
+        self->tabela_processos[nucleo->mlfq_fim[0]].prox_pronto = nucleo->mlfq_inicio[nivel];
+      }
+      nucleo->mlfq_fim[0] = nucleo->mlfq_fim[nivel];
+      nucleo->mlfq_inicio[nivel] = -1;
+      nucleo->mlfq_fim[nivel] = -1;
+    }
+    nucleo->mlfq_niveis_ocupados = nucleo->mlfq_inicio[0] == -1 ? 0 : 1;
+  }
+}
+
+#elif ESCALONADOR_ATIVO == ESCALONADOR_PRIORIDADE
+
+// os processos prontos ficam em um heap, o de menor 'prioridade' primeiro
+//   (entre iguais, o de menor índice, como na varredura da tabela)
+// a prioridade só muda para o processo que estava executando (em
+//   so_salva_estado_da_cpu), e ele entra no heap já com o valor novo
+
+// a chave de um processo no heap
+// a prioridade não é negativa, e para um float não negativo a ordem dos
+//   bits lidos como inteiro é a mesma dos valores
+static long so__chave_prioridade(float prioridade)
+{
+  uint32_t bits;
+  memcpy(&bits, &prioridade, sizeof(bits));
+  return bits;
+}
+
+// Insere um processo no heap de prontos (ou atualiza a chave, se já estiver)
+static void insere_fila_prontos(so_t *self, int processo_idx)
+{
+  float prioridade = self->tabela_processos[processo_idx].prioridade;
+  heap_insere(self->heap_prontos, processo_idx, so__chave_prioridade(prioridade));
+}
+
+// Remove e retorna o processo pronto de menor prioridade, ou -1
+// o heap é único, todas as CPUs escolhem dele
+static int remove_fila_prontos(so_t *self)
+{
+  int processo_idx = heap_menor(self->heap_prontos);
+  if (processo_idx != -1) {
+    heap_remove(self->heap_prontos, processo_idx);
+  }
+  return processo_idx;
+}
+
+// Tira um processo do heap de prontos, se ele estiver lá
+static void retira_da_fila_prontos(so_t *self, int processo_idx)
+{
+  heap_remove(self->heap_prontos, processo_idx);
+}
+
+#elif ESCALONADOR_ATIVO == ESCALONADOR_CFS
+
+// CFS: os processos prontos ficam em um heap, o de menor tempo virtual
+//   (vruntime) primeiro; o tempo virtual só muda para o processo que estava
+//   executando, que entra no heap já com o valor novo
+
+// Insere um processo no heap de prontos
+// quem estava bloqueado não volta com o tempo virtual muito para trás dos
+//   outros, senão tomaria a CPU por muito tempo
+static void insere_fila_prontos(so_t *self, int processo_idx)
+{
+  processo_t *p = &self->tabela_processos[processo_idx];
+  long limite = self->cfs_vruntime_min - CFS_CREDITO_ESPERA;
+  if (p->vruntime < limite) p->vruntime = limite;
+  if (!heap_contem(self->heap_prontos, processo_idx)) {
+    self->cfs_peso_prontos += p->peso;
+  }
+  heap_insere(self->heap_prontos, processo_idx, p->vruntime);
+}
+
+// Remove e retorna o processo pronto de menor tempo virtual, ou -1
+// o heap é único, todas as CPUs escolhem dele
+static int remove_fila_prontos(so_t *self)
+{
+  int processo_idx = heap_menor(self->heap_prontos);
+  if (processo_idx != -1) {
+    heap_remove(self->heap_prontos, processo_idx);
+    self->cfs_peso_prontos -= self->tabela_processos[processo_idx].peso;
+  }
+  return processo_idx;
+}
+
+// Tira um processo do heap de prontos, se ele estiver lá, e o peso dele da
+//   soma dos que disputam a CPU
+static void retira_da_fila_prontos(so_t *self, int processo_idx)
+{
+  if (!heap_contem(self->heap_prontos, processo_idx)) return;
+  heap_remove(self->heap_prontos, processo_idx);
+  self->cfs_peso_prontos -= self->tabela_processos[processo_idx].peso;
+}
+
+// a fatia de tempo (em interrupções do relógio) do processo escolhido: a
+//   parte de CFS_LATENCIA proporcional ao peso dele entre os que disputam a
+//   CPU, mas pelo menos CFS_FATIA_MINIMA
+static int so_cfs_fatia(so_t *self, int processo_idx)
+{
+  long peso = self->tabela_processos[processo_idx].peso;
+  long fatia = CFS_LATENCIA * peso / (self->cfs_peso_prontos + peso);
+  return fatia < CFS_FATIA_MINIMA ? CFS_FATIA_MINIMA : fatia;
+}
+
 #endif
 
 //GERAR RELATORIO
@@ -369,6 +1048,7 @@ void so_gera_relatorio(so_t *self)
   // --- Métricas Globais ---
   console_printf("\n[Metricas Globais]");
   console_printf("  - Tempo total de execucao: %d instrucoes", tempo_final);
+  console_printf("  - Numero de CPUs: %d", self->n_nucleos);
   console_printf("  - Numero total de processos criados: %d", self->num_processos_criados);
   console_printf("  - Tempo em que a CPU ficou ociosa: %ld instrucoes", self->tempo_ocioso);
   console_printf("  - Numero total de preempcoes: %d", self->num_preempcoes_total);
@@ -378,11 +1058,35 @@ void so_gera_relatorio(so_t *self)
       console_printf("    > IRQ %d (%s): %d vezes", i, irq_nome(i), self->cont_interrupcoes[i]);
     }
   }
+  console_printf("  - TLB (%d conjuntos x %d vias, paginas de %d palavras):",
+                 TLB_N_CONJUNTOS, TLB_N_VIAS, self->tam_pagina);
+  for (int c = 0; c < self->n_nucleos; c++) {
+    long acertos, faltas, invalidacoes, esvaziamentos;
+    mmu_estatisticas_tlb(self->nucleos[c].mmu, &acertos, &faltas, &invalidacoes,
+                         &esvaziamentos);
+    long acessos = acertos + faltas;
+    console_printf("    > CPU %d: %ld acertos, %ld faltas (%.1f%% de acerto), %ld invalidacoes, %ld esvaziamentos",
+                   c, acertos, faltas, acessos > 0 ? 100.0 * acertos / acessos : 0.0,
+                   invalidacoes, esvaziamentos);
+  }
+  int faltas = 0;
+  for (int i = 0; i < self->tam_tabela_processos; i++) {
+    faltas += self->tabela_processos[i].num_page_faults;
+  }
+  console_printf("  - Substituicao de paginas '%s': %d faltas de pagina, %d substituicoes",
+                 self->politica->nome, faltas, self->num_substituicoes);
+  if (self->traco != NULL) {
+    // os quadros que podem conter paginas dos processos; o otimo comeca com
+    // as paginas pre-carregadas do init, como a politica
+    int n_quadros = self->max_quadros_fisicos - (mmu_pagina(self->nucleos[0].mmu, CPU_END_FIM_PROT) + 1);
+    console_printf("    > otimo (Belady) no mesmo traco (%d referencias, %d quadros): %ld faltas de pagina",
+                   traco_tam(self->traco), n_quadros, traco_faltas_otimo(self->traco, n_quadros));
+  }
 
   int cont=0;
   // --- Métricas por Processo ---
   console_printf("\n[Metricas por Processo]");
-  for (int i = 0; i < MAX_PROCESSOS; i++) {
+  for (int i = 0; i < self->tam_tabela_processos; i++) {
     processo_t *p = &self->tabela_processos[i];
     if (p->tempo_criacao > 0) { // Imprime apenas para processos que existiram
       console_printf("\n  >> Processo P%d:", cont); // O PID ainda será válido neste ponto
@@ -420,6 +1124,233 @@ void so_gera_relatorio(so_t *self)
   console_printf("\n--- FIM DO RELATORIO ---");
 }
 
+// ---------------------------------------------------------------------
+// TABELA DE PROCESSOS {{{1
+// ---------------------------------------------------------------------
+
+// a tabela cresce (dobra) quando não tem entrada livre; as entradas livres
+//   ficam em um heap, para reusar sempre a de menor índice, e um
+//   espalhamento encontra a entrada de um processo pelo pid
+
+// aumenta a tabela de processos para 'tam' entradas, junto com as estruturas
+//   que têm uma entrada por processo
+// retorna false se faltar memória (a tabela continua com o tamanho anterior)
+static bool so_aumenta_tabela_processos(so_t *self, int tam)
+{
+  int tam_ant = self->tam_tabela_processos;
+  processo_t *tabela = realloc(self->tabela_processos, tam * sizeof(*tabela));
+  if (tabela == NULL) return false;
+  self->tabela_processos = tabela;
+  int *desbloqueados = realloc(self->desbloqueados, tam * sizeof(*desbloqueados));
+  if (desbloqueados == NULL) return false;
+  self->desbloqueados = desbloqueados;
+
+  // as filas de prontos são circulares; são copiadas a partir do início
+  for (int c = 0; c < self->n_nucleos; c++) {
+    nucleo_t *nucleo = &self->nucleos[c];
+    int *fila = malloc(tam * sizeof(*fila));
+    if (fila == NULL) return false;
+    for (int k = 0; k < nucleo->n_prontos; k++) {
+      fila[k] = nucleo->fila_prontos[(nucleo->inicio_fila + k) % tam_ant];
+    }
+    free(nucleo->fila_prontos);
+    nucleo->fila_prontos = fila;
+    nucleo->inicio_fila = 0;
+    nucleo->fim_fila = nucleo->n_prontos;
+  }
+
+  int n_listas = 1;
+  while (n_listas < tam) n_listas *= 2;
+  if (n_listas != self->n_listas_hash) {
+    int *hash_pid = malloc(n_listas * sizeof(*hash_pid));
+    if (hash_pid == NULL) return false;
+    free(self->hash_pid);
+    self->hash_pid = hash_pid;
+    self->n_listas_hash = n_listas;
+    so_refaz_indices(self, tam_ant);
+  }
+
+  // as entradas novas são zeradas, para poderem ser salvas em um snapshot
+  memset(&self->tabela_processos[tam_ant], 0, (tam - tam_ant) * sizeof(processo_t));
+  heap_aumenta(self->espera_disco, tam);
+  heap_aumenta(self->heap_prontos, tam);
+  heap_aumenta(self->entradas_livres, tam);
+  for (int i = tam_ant; i < tam; i++) {
+    processo_t *p = &self->tabela_processos[i];
+    p->estado = TERMINADO; // marcar como livre
+    p->pid = -1; // e deixar sem pid
+    p->idx_esperado = -1;
+    p->prox_espera = -1;
+    p->primeiro_esperando = -1;
+    p->prox_hash = -1;
+    heap_insere(self->entradas_livres, i, i);
+  }
+  self->tam_tabela_processos = tam;
+  return true;
+}
+
+static int so__lista_hash(so_t *self, int pid)
+{
+  return pid & (self->n_listas_hash - 1);
+}
+
+static void so_hash_insere(so_t *self, int idx)
+{
+  processo_t *p = &self->tabela_processos[idx];
+  int *lista = &self->hash_pid[so__lista_hash(self, p->pid)];
+  p->prox_hash = *lista;
+  *lista = idx;
+}
+
+static void so_hash_remove(so_t *self, int idx)
+{
+  processo_t *p = &self->tabela_processos[idx];
+  int *ant = &self->hash_pid[so__lista_hash(self, p->pid)];
+  while (*ant != idx) {
+    ant = &self->tabela_processos[*ant].prox_hash;
+  }
+  *ant = p->prox_hash;
+  p->prox_hash = -1;
+}
+
+// refaz o espalhamento e o heap de entradas livres a partir das primeiras
+//   'tam' entradas da tabela (depois de aumentar o espalhamento ou carregar
+//   um snapshot)
+static void so_refaz_indices(so_t *self, int tam)
+{
+  for (int l = 0; l < self->n_listas_hash; l++) {
+    self->hash_pid[l] = -1;
+  }
+  heap_esvazia(self->entradas_livres);
+  for (int i = 0; i < tam; i++) {
+    if (self->tabela_processos[i].estado == TERMINADO) {
+      heap_insere(self->entradas_livres, i, i);
+    } else {
+      so_hash_insere(self, i);
+    }
+  }
+}
+
+// retorna o índice na tabela do processo com o pid dado, ou -1 se não existe
+static int so_procura_processo(so_t *self, int pid)
+{
+  int idx = self->hash_pid[so__lista_hash(self, pid)];
+  while (idx != -1 && self->tabela_processos[idx].pid != pid) {
+    idx = self->tabela_processos[idx].prox_hash;
+  }
+  return idx;
+}
+
+// retorna o índice de uma entrada livre da tabela (a de menor índice),
+//   aumentando a tabela se preciso, ou -1 se faltar memória
+// a entrada continua livre até so_registra_processo
+static int so_entrada_livre(so_t *self)
+{
+  if (heap_n_itens(self->entradas_livres) == 0
+      && !so_aumenta_tabela_processos(self, 2 * self->tam_tabela_processos)) {
+    return -1;
+  }
+  return heap_menor(self->entradas_livres);
+}
+
+// o processo na entrada 'idx' foi criado, e já tem pid
+static void so_registra_processo(so_t *self, int idx)
+{
+  heap_remove(self->entradas_livres, idx);
+  so_hash_insere(self, idx);
+}
+
+// o processo na entrada 'idx' terminou; deve ser chamada antes de tirar o pid
+static void so_libera_entrada(so_t *self, int idx)
+{
+  so_hash_remove(self, idx);
+  heap_insere(self->entradas_livres, idx, idx);
+}
+
+// ---------------------------------------------------------------------
+// FILAS DE ESPERA {{{1
+// ---------------------------------------------------------------------
+
+// um processo bloqueado fica em uma estrutura conforme o motivo:
+//   LE e ESCR: na fila do dispositivo (disp_entrada ou disp_saida)
+//   ESPERA: na lista dos que esperam o processo idx_esperado
+//   PAGINACAO: no heap espera_disco, pelo tempo de termino da E/S
+// assim so_trata_pendencias e so_mata_processo so olham os processos cuja
+//   espera pode ter terminado, e nao a tabela toda
+
+// o dispositivo em que o processo bloqueado por E/S esta esperando
+static dispositivo_id_t so__disp_esperado(processo_t *p)
+{
+  return p->tipo_bloqueio == BLOQUEIO_LE ? p->disp_entrada : p->disp_saida;
+}
+
+// coloca o processo, ja bloqueado por LE ou ESCR, no fim da fila do dispositivo
+static void so_espera_dispositivo(so_t *self, int idx)
+{
+  processo_t *p = &self->tabela_processos[idx];
+  dispositivo_id_t disp = so__disp_esperado(p);
+  p->prox_espera = -1;
+  if (self->espera_disp_inicio[disp] == -1) {
+    self->espera_disp_inicio[disp] = idx;
+  } else {
+    self->tabela_processos[self->espera_disp_fim[disp]].prox_espera = idx;
+  }
+  self->espera_disp_fim[disp] = idx;
+}
+
+// coloca o processo, ja bloqueado por ESPERA, na lista do processo esperado
+static void so_espera_processo(so_t *self, int idx, int idx_alvo)
+{
+  processo_t *p = &self->tabela_processos[idx];
+  processo_t *alvo = &self->tabela_processos[idx_alvo];
+  p->idx_esperado = idx_alvo;
+  p->prox_espera = alvo->primeiro_esperando;
+  alvo->primeiro_esperando = idx;
+}
+
+// tira o processo bloqueado da estrutura em que ele esta esperando
+// o primeiro de uma fila sai em tempo constante
+static void so_tira_da_espera(so_t *self, int idx)
+{
+  processo_t *p = &self->tabela_processos[idx];
+  int *inicio;
+  int *fim = NULL;
+  switch (p->tipo_bloqueio) {
+    case BLOQUEIO_LE:
+    case BLOQUEIO_ESCR:
+      inicio = &self->espera_disp_inicio[so__disp_esperado(p)];
+      fim = &self->espera_disp_fim[so__disp_esperado(p)];
+      break;
+    case BLOQUEIO_ESPERA:
+      inicio = &self->tabela_processos[p->idx_esperado].primeiro_esperando;
+      p->idx_esperado = -1;
+      break;
+    case BLOQUEIO_PAGINACAO:
+      heap_remove(self->espera_disco, idx);
+      return;
+    default:
+      return;
+  }
+  int ant = -1;
+  for (int i = *inicio; i != idx; i = self->tabela_processos[i].prox_espera) {
+    ant = i;
+  }
+  if (ant == -1) {
+    *inicio = p->prox_espera;
+  } else {
+    self->tabela_processos[ant].prox_espera = p->prox_espera;
+  }
+  if (fim != NULL && *fim == idx) {
+    *fim = ant;
+  }
+  p->prox_espera = -1;
+}
+
+static int so__compara_idx(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
 // ---------------------------------------------------------------------
 // TRATAMENTO DE INTERRUPÇÃO {{{1
 // ---------------------------------------------------------------------
@@ -430,6 +1361,7 @@ static void so_trata_irq(so_t *self, int irq);
 static void so_trata_pendencias(so_t *self);
 static void so_escalona(so_t *self);
 static int so_despacha(so_t *self);
+static void so_termina_processo_morto(so_t *self);
 
 // função a ser chamada pela CPU quando executa a instrução CHAMAC, no tratador de
 //   interrupção em assembly
@@ -438,8 +1370,8 @@ static int so_despacha(so_t *self);
 //   a instrução CHAMAC
 // a instrução CHAMAC só deve ser executada pelo tratador de interrupção
 //
-// o primeiro argumento é um ponteiro para o SO, o segundo é a identificação
-//   da interrupção
+// o primeiro argumento é um ponteiro para o núcleo da CPU que executou a
+//   instrução (que aponta para o SO), o segundo é a identificação da interrupção
 // o valor retornado por esta função é colocado no registrador A, e pode ser
 //   testado pelo código que está após o CHAMAC. No tratador de interrupção em
 //   assembly esse valor é usado para decidir se a CPU deve retornar da interrupção
@@ -447,9 +1379,12 @@ static int so_despacha(so_t *self);
 //   outra interrupção
 static int so_trata_interrupcao(void *argC, int reg_A)
 {
-  so_t *self = argC;
+  nucleo_t *nucleo = argC;
+  so_t *self = nucleo->so;
   irq_t irq = reg_A;
 
+  // as funções do SO tratam da CPU em self->nucleo
+  self->nucleo = nucleo;
   self->cont_interrupcoes[irq]++;
   // esse print polui bastante, recomendo tirar quando estiver com mais confiança
   console_printf("SO: recebi IRQ %d (%s)", irq, irq_nome(irq));
@@ -457,6 +1392,8 @@ static int so_trata_interrupcao(void *argC, int reg_A)
   so_salva_estado_da_cpu(self);
   // faz o atendimento da interrupção
   so_trata_irq(self, irq);
+  // termina o processo desta CPU se ele foi morto por outra
+  so_termina_processo_morto(self);
   // faz o processamento independente da interrupção
   so_trata_pendencias(self);
   // escolhe o próximo processo a executar
@@ -467,17 +1404,22 @@ static int so_trata_interrupcao(void *argC, int reg_A)
 
 static void so_salva_estado_da_cpu(so_t *self)
 {
-  if (self->processo_atual_idx == NENHUM_PROCESSO) {
+  if (self->nucleo->processo_atual_idx == NENHUM_PROCESSO) {
     return;
   }
   
   // obtém um ponteiro para o PCB do processo que estava executando
-  processo_t *p = &self->tabela_processos[self->processo_atual_idx];
+  processo_t *p = &self->tabela_processos[self->nucleo->processo_atual_idx];
 
   // PARTE 3 - T2
   int tempo_agora;
   if (es_le(self->es, D_RELOGIO_INSTRUCOES, &tempo_agora) == ERR_OK) {
 
+      // Para o tempo virtual do CFS (cresce mais devagar para quem tem mais peso)
+      #if ESCALONADOR_ATIVO == ESCALONADOR_CFS
+        p->vruntime += (long)(tempo_agora - p->tempo_entrou_no_estado_atual) * PESO_PADRAO * PESO_PADRAO / p->peso;
+      #endif
+
       // Para as métricas de tempo
       p->tempo_total_executando += tempo_agora - p->tempo_entrou_no_estado_atual;
       p->tempo_entrou_no_estado_atual = tempo_agora;
@@ -493,14 +1435,15 @@ static void so_salva_estado_da_cpu(so_t *self)
   }
 
   // lê o estado da CPU que foi salvo na memória pela interrupção
+  // a área de salvamento é própria de cada CPU, é acessada pela MMU dela
   int pc, a, erro, x;
   int comp;
 
-  if (mem_le(self->mem, CPU_END_PC, &pc) != ERR_OK ||
-      mem_le(self->mem, CPU_END_A, &a) != ERR_OK ||
-      mem_le(self->mem, CPU_END_erro, &erro) != ERR_OK ||
-      mem_le(self->mem, 59, &x) != ERR_OK || // X salvo pelo trata_int.asm
-      mem_le(self->mem, CPU_END_complemento, &comp) != ERR_OK) { 
+  if (mmu_le(self->nucleo->mmu, CPU_END_PC, &pc, supervisor) != ERR_OK ||
+      mmu_le(self->nucleo->mmu, CPU_END_A, &a, supervisor) != ERR_OK ||
+      mmu_le(self->nucleo->mmu, CPU_END_erro, &erro, supervisor) != ERR_OK ||
+      mmu_le(self->nucleo->mmu, 59, &x, supervisor) != ERR_OK || // X salvo pelo trata_int.asm
+      mmu_le(self->nucleo->mmu, CPU_END_complemento, &comp, supervisor) != ERR_OK) { 
     console_printf("SO: erro na leitura dos registradores ao salvar contexto.");
     self->erro_interno = true;
     return;
@@ -520,202 +1463,133 @@ static void so_salva_estado_da_cpu(so_t *self)
   }
 }
 
-static void so_trata_pendencias(so_t *self)
+// desbloqueia um processo cuja espera por E/S terminou
+static void so_desbloqueia(so_t *self, int idx)
 {
-    // Percorre a tabela de processos para encontrar processos bloqueados
-  for (int i = 0; i < MAX_PROCESSOS; i++) 
-  {
-    processo_t *p = &self->tabela_processos[i];
+  processo_t *p = &self->tabela_processos[idx];
 
-    if (p->estado == BLOQUEADO) 
-    {
-      // O processo está bloqueado, verifica o motivo
-      
-      if (p->tipo_bloqueio == BLOQUEIO_LE) 
-      {
-        // Bloqueado à espera de LEITURA. O dispositivo já está livre?
-        dispositivo_id_t teclado = p->disp_entrada;
-        dispositivo_id_t teclado_ok = teclado + TERM_TECLADO_OK - TERM_TECLADO;
-        int estado_dev;
-        es_le(self->es, teclado_ok, &estado_dev);
-
-        if (estado_dev != 0) 
-        {
-          //metricas
-          int tempo_agora;
-          es_le(self->es, D_RELOGIO_INSTRUCOES, &tempo_agora);
-          p->tempo_total_bloqueado += tempo_agora - p->tempo_entrou_no_estado_atual;
-          p->vezes_pronto++;
-          p->tempo_desbloqueio = tempo_agora;
-          p->tempo_entrou_no_estado_atual = tempo_agora;
-
-          // dispositivo pronto
-          int dado;
-          es_le(self->es, teclado, &dado);
-          p->regA = dado; // Coloca o resultado no registador A
-          p->estado = PRONTO; // Desbloqueia o processo
-          #if ESCALONADOR_ATIVO == ESCALONADOR_ROUND_ROBIN
-          insere_fila_prontos(self, i); // Adiciona na fila
-          #endif
-          p->tipo_bloqueio = BLOQUEIO_NENHUM;
-          console_printf("SO: Processo %d desbloqueado apos leitura.", p->pid);
-        }
-      } 
-      else if (p->tipo_bloqueio == BLOQUEIO_ESCR) 
-      {
-        // Bloqueado à espera de ESCRITA. O dispositivo já está livre?
-        dispositivo_id_t tela = p->disp_saida;
-        dispositivo_id_t tela_ok = tela + TERM_TELA_OK - TERM_TELA;
-        int estado_dev;
-        es_le(self->es, tela_ok, &estado_dev);
-
-        if (estado_dev != 0) 
-        {
-          //metricas
-          int tempo_agora;
-          es_le(self->es, D_RELOGIO_INSTRUCOES, &tempo_agora);
-          p->tempo_total_bloqueado += tempo_agora - p->tempo_entrou_no_estado_atual;
-          p->vezes_pronto++;
-          p->tempo_desbloqueio = tempo_agora;
-          p->tempo_entrou_no_estado_atual = tempo_agora;
-
-          // dispositivo pronto
-          int dado = p->regX; // O dado a escrever ainda está em regX
-          es_escreve(self->es, tela, dado);
-          p->regA = 0; // Retorna 0 (sucesso)
-          p->estado = PRONTO; // Desbloqueia o processo
-          #if ESCALONADOR_ATIVO == ESCALONADOR_ROUND_ROBIN
-          insere_fila_prontos(self, i); // Adiciona na fila]
-          #endif
-          p->tipo_bloqueio = BLOQUEIO_NENHUM;
-          console_printf("SO: Processo %d desbloqueado apos escrita.", p->pid);
-        }
-      } 
-      else if (p->tipo_bloqueio == BLOQUEIO_ESPERA) 
-      {
-        // Bloqueado à espera que outro processo morra
-        int pid_esperado = p->pid_esperado;
-        bool esperado_terminou = true; // assume que terminou ate que se prove o contrario!
-        
-        // procura o processo esperado na tabela
-        for (int j = 0; j < MAX_PROCESSOS; j++) 
-        {
-          if (self->tabela_processos[j].pid == pid_esperado) 
-          {
-              // encontrou! portanto nao terminou
-                esperado_terminou = false;
-                break;
-            }
-        }
-        if (esperado_terminou) 
-        {
-            //metricas
-            int tempo_agora;
-            es_le(self->es, D_RELOGIO_INSTRUCOES, &tempo_agora);
-            p->tempo_total_bloqueado += tempo_agora - p->tempo_entrou_no_estado_atual;
-            p->vezes_pronto++;
-            p->tempo_desbloqueio = tempo_agora;
-            p->tempo_entrou_no_estado_atual = tempo_agora;
-
-
-            // processo nao existe mais. desbloqueia!
-            p->estado = PRONTO;
-            #if ESCALONADOR_ATIVO == ESCALONADOR_ROUND_ROBIN
-            insere_fila_prontos(self, i); // Adiciona na fila
-            #endif
-            p->tipo_bloqueio = BLOQUEIO_NENHUM;
-            p->pid_esperado = -1;
-            p->regA = 0; // Sucesso na espera
-            console_printf("SO: Processo %d desbloqueado (pendencias) pois %d terminou.", p->pid, pid_esperado);
-        }
-      } 
-      else if (p->tipo_bloqueio == BLOQUEIO_PAGINACAO) 
-      {
-        // --- NOVO T3 ---
-        // Bloqueado a espera de E/S de disco (Page Fault)
-        int tempo_agora;
-        es_le(self->es, D_RELOGIO_INSTRUCOES, &tempo_agora);
-        long tempo_termino_io = p->tempo_termino_io_disco;
-
-        if (tempo_agora >= tempo_termino_io) {
-          // E/S de disco terminada! Desbloqueia o processo.
-          console_printf("SO: Processo %d desbloqueado apos E/S de disco (Page Fault).", p->pid);
-          
-          //metricas
-          p->tempo_total_bloqueado += tempo_agora - p->tempo_entrou_no_estado_atual;
-          p->vezes_pronto++;
-          p->tempo_desbloqueio = tempo_agora; // Correto para a metrica de tempo de resposta
-          p->tempo_entrou_no_estado_atual = tempo_agora;
-
-          // Desbloqueia
-          p->estado = PRONTO;
-          #if ESCALONADOR_ATIVO == ESCALONADOR_ROUND_ROBIN
-          insere_fila_prontos(self, i); // Adiciona na fila
-          #endif
-          p->tipo_bloqueio = BLOQUEIO_NENHUM;
-          p->tempo_termino_io_disco = 0;
-
-          // o processo foi interrompido *antes* de executar
-          // a instrucao que causou a falha. O PC salvo aponta
-          // para essa instrucao. Ao retornar, a CPU ira executa-la
-          // novamente, mas agora a pagina esta mapeada.
-        }
+  //metricas
+  int tempo_agora;
+  es_le(self->es, D_RELOGIO_INSTRUCOES, &tempo_agora);
+  p->tempo_total_bloqueado += tempo_agora - p->tempo_entrou_no_estado_atual;
+  p->vezes_pronto++;
+  p->tempo_desbloqueio = tempo_agora; // Correto para a metrica de tempo de resposta
+  p->tempo_entrou_no_estado_atual = tempo_agora;
+
+  if (p->tipo_bloqueio == BLOQUEIO_LE || p->tipo_bloqueio == BLOQUEIO_ESCR) {
+    console_printf("SO: Processo %d desbloqueado apos %s.", p->pid,
+                   p->tipo_bloqueio == BLOQUEIO_LE ? "leitura" : "escrita");
+    #if ESCALONADOR_ATIVO == ESCALONADOR_MLFQ
+    // quem bloqueia esperando o terminal sobe um nível
+    if (p->nivel_mlfq > 0) p->nivel_mlfq--;
+    #endif
+  } else {
+    // o processo foi interrompido *antes* de executar
+    // a instrucao que causou a falha. O PC salvo aponta
+    // para essa instrucao. Ao retornar, a CPU ira executa-la
+    // novamente, mas agora a pagina esta mapeada.
+    console_printf("SO: Processo %d desbloqueado apos E/S de disco (Page Fault).", p->pid);
+    p->tempo_termino_io_disco = 0;
+  }
+
+  p->estado = PRONTO; // Desbloqueia o processo
+  insere_fila_prontos(self, idx); // Adiciona na fila
+  p->tipo_bloqueio = BLOQUEIO_NENHUM;
+}
+
+// desbloqueia os processos cuja E/S terminou
+// só são consultados os dispositivos com processos na fila e o começo do
+//   heap do disco, então o custo não cresce com o número de processos
+// (a espera pelo fim de outro processo é tratada em so_mata_processo)
+static void so_trata_pendencias(so_t *self)
+{
+  int *desbloqueados = self->desbloqueados;
+  int n = 0;
+
+  // terminais: cada fila é atendida na ordem de chegada, enquanto o
+  //   dispositivo estiver pronto
+  for (dispositivo_id_t disp = 0; disp < N_DISPOSITIVOS; disp++) {
+    while (self->espera_disp_inicio[disp] != -1) {
+      int idx = self->espera_disp_inicio[disp];
+      processo_t *p = &self->tabela_processos[idx];
+      int estado_dev;
+      if (p->tipo_bloqueio == BLOQUEIO_LE) {
+        es_le(self->es, disp + TERM_TECLADO_OK - TERM_TECLADO, &estado_dev);
+        if (estado_dev == 0) break;
+        int dado;
+        es_le(self->es, disp, &dado);
+        p->regA = dado; // Coloca o resultado no registador A
+      } else {
+        es_le(self->es, disp + TERM_TELA_OK - TERM_TELA, &estado_dev);
+        if (estado_dev == 0) break;
+        es_escreve(self->es, disp, p->regX); // O dado a escrever ainda está em regX
+        p->regA = 0; // Retorna 0 (sucesso)
       }
+      so_tira_da_espera(self, idx);
+      desbloqueados[n++] = idx;
     }
   }
+
+  // disco: as E/S de falta de página que já terminaram
+  int tempo_agora;
+  es_le(self->es, D_RELOGIO_INSTRUCOES, &tempo_agora);
+  int idx;
+  while ((idx = heap_menor(self->espera_disco)) != -1
+         && heap_chave(self->espera_disco, idx) <= tempo_agora) {
+    so_tira_da_espera(self, idx);
+    desbloqueados[n++] = idx;
+  }
+
+  // entram na fila de prontos na ordem da tabela, como quando ela era
+  //   percorrida inteira
+  qsort(desbloqueados, n, sizeof(int), so__compara_idx);
+  for (int i = 0; i < n; i++) {
+    so_desbloqueia(self, desbloqueados[i]);
+  }
 }
 
 static void so_escalona(so_t *self)
 {
   // guarda quem estava executando antes de o escalonador rodar.
-  int idx_anterior = self->processo_atual_idx;
+  int idx_anterior = self->nucleo->processo_atual_idx;
 
   
   #if ESCALONADOR_ATIVO == ESCALONADOR_ROUND_ROBIN
   console_printf("SO: Escalonador Round-Robin em acao.");
   processo_t *p_atual = NULL;
-  if (self->processo_atual_idx != -1) {
-    p_atual = &self->tabela_processos[self->processo_atual_idx];
+  if (self->nucleo->processo_atual_idx != -1) {
+    p_atual = &self->tabela_processos[self->nucleo->processo_atual_idx];
   }
   
   // se o processo ainda tem quantum em uma irq relogio, deve voltar para a cpu
-  if (self->processo_atual_idx != -1 && p_atual->estado == PRONTO && self->quantum_restante > 0)  
+  if (self->nucleo->processo_atual_idx != -1 && p_atual->estado == PRONTO && self->nucleo->quantum_restante > 0)  
   {
     console_printf("SO: Processo atual ainda tem quantum. Sem escalonamento.");
-    console_printf("SO: Processo segue. PID = %d", self->tabela_processos[self->processo_atual_idx].pid);
+    console_printf("SO: Processo segue. PID = %d", self->tabela_processos[self->nucleo->processo_atual_idx].pid);
     return;
   }
 
   // se o processo que estava a ser executado foi preemptido e ainda está PRONTO, ele deve voltar para o fim da fila.
-  if (self->processo_atual_idx != -1 && p_atual->estado == PRONTO) 
+  if (self->nucleo->processo_atual_idx != -1 && p_atual->estado == PRONTO) 
   {
       #if ESCALONADOR_ATIVO == ESCALONADOR_ROUND_ROBIN
-      insere_fila_prontos(self, self->processo_atual_idx);
+      insere_fila_prontos(self, self->nucleo->processo_atual_idx);
       #endif
   }
   // O próximo a ser executado é o primeiro da fila de prontos
-  self->processo_atual_idx = remove_fila_prontos(self);
+  self->nucleo->processo_atual_idx = remove_fila_prontos(self);
 
 #elif ESCALONADOR_ATIVO == ESCALONADOR_PRIORIDADE
   console_printf("SO: Escalonador por Prioridade em acao.");
   
   
-  int melhor_idx = -1;
-  double menor_prio = 2.0; // Valor inicial > 1.0
-
-  // Percorre toda a tabela de processos em busca do candidato ideal.
-  for (int i = 0; i < MAX_PROCESSOS; i++) 
+  // o processo que estava executando volta a disputar a CPU, com a
+  //   prioridade recalculada; o candidato ideal é o primeiro do heap
+  if (idx_anterior != -1 && self->tabela_processos[idx_anterior].estado == PRONTO)
   {
-    processo_t *p = &self->tabela_processos[i];
-    if (p->estado == PRONTO) 
-    {
-      if (p->prioridade < menor_prio) 
-      {
-        menor_prio = p->prioridade;
-        melhor_idx = i;
-      }
-    }
+    insere_fila_prontos(self, idx_anterior);
   }
+  int melhor_idx = remove_fila_prontos(self);
 
   if (idx_anterior != -1 && // havia alguem executando
       melhor_idx != -1 &&  // tem alguem para executar
@@ -730,7 +1604,57 @@ static void so_escalona(so_t *self)
   }
 
   // Define o processo escolhido como o próximo a ser executado.
-  self->processo_atual_idx = melhor_idx;
+  self->nucleo->processo_atual_idx = melhor_idx;
+
+#elif ESCALONADOR_ATIVO == ESCALONADOR_MLFQ
+  console_printf("SO: Escalonador MLFQ em acao.");
+  if (idx_anterior != -1 && self->tabela_processos[idx_anterior].estado == PRONTO)
+  {
+    processo_t *p_atual = &self->tabela_processos[idx_anterior];
+    if (self->nucleo->quantum_restante > 0) {
+      // ainda tem quantum: segue, a menos que haja processo pronto em
+      //   nível mais prioritário
+      if (so__mlfq_nivel_mais_alto(self->nucleo) >= p_atual->nivel_mlfq) {
+        console_printf("SO: Processo segue. PID = %d", p_atual->pid);
+        return;
+      }
+      p_atual->num_preempcoes++;
+      self->num_preempcoes_total++;
+      console_printf("SO: Preempcao MLFQ! PID %d sai para um processo de nivel mais alto", p_atual->pid);
+    } else if (p_atual->nivel_mlfq < N_NIVEIS_MLFQ - 1) {
+      // usou o quantum todo: desce um nível
+      p_atual->nivel_mlfq++;
+    }
+    insere_fila_prontos(self, idx_anterior);
+  }
+  self->nucleo->processo_atual_idx = remove_fila_prontos(self);
+
+#elif ESCALONADOR_ATIVO == ESCALONADOR_CFS
+  console_printf("SO: Escalonador CFS em acao.");
+  if (idx_anterior != -1 && self->tabela_processos[idx_anterior].estado == PRONTO)
+  {
+    processo_t *p_atual = &self->tabela_processos[idx_anterior];
+    if (self->nucleo->quantum_restante > 0) {
+      // ainda tem fatia: segue, a menos que um processo pronto esteja bem
+      //   atrás no tempo virtual (um que acabou de desbloquear)
+      int primeiro = heap_menor(self->heap_prontos);
+      if (primeiro == -1
+          || p_atual->vruntime - self->tabela_processos[primeiro].vruntime <= CFS_GRANULARIDADE) {
+        console_printf("SO: Processo segue. PID = %d", p_atual->pid);
+        return;
+      }
+      p_atual->num_preempcoes++;
+      self->num_preempcoes_total++;
+      console_printf("SO: Preempcao CFS! PID %d tomou a vez do PID %d",
+                     self->tabela_processos[primeiro].pid, p_atual->pid);
+    }
+    insere_fila_prontos(self, idx_anterior);
+  }
+  int melhor_idx = remove_fila_prontos(self);
+  if (melhor_idx != -1 && self->tabela_processos[melhor_idx].vruntime > self->cfs_vruntime_min) {
+    self->cfs_vruntime_min = self->tabela_processos[melhor_idx].vruntime;
+  }
+  self->nucleo->processo_atual_idx = melhor_idx;
 
 #else
   // Se um valor inválido for definido em ESCALONADOR_ATIVO, o compilador dará um erro.
@@ -738,12 +1662,21 @@ static void so_escalona(so_t *self)
 #endif
   
   // Se mudou o processo OU se o quantum do anterior acabou
-  if (self->processo_atual_idx != idx_anterior || self->quantum_restante <= 0) 
+  if (self->nucleo->processo_atual_idx != idx_anterior || self->nucleo->quantum_restante <= 0) 
   {
-    self->quantum_restante = QUANTUM;
+    self->nucleo->quantum_restante = QUANTUM;
+    #if ESCALONADOR_ATIVO == ESCALONADOR_MLFQ
+    if (self->nucleo->processo_atual_idx != -1) {
+      self->nucleo->quantum_restante <<= self->tabela_processos[self->nucleo->processo_atual_idx].nivel_mlfq;
+    }
+    #elif ESCALONADOR_ATIVO == ESCALONADOR_CFS
+    if (self->nucleo->processo_atual_idx != -1) {
+      self->nucleo->quantum_restante = so_cfs_fatia(self, self->nucleo->processo_atual_idx);
+    }
+    #endif
   }
-  if (self->processo_atual_idx != -1) {
-    console_printf("SO: Processo escolhido. PID = %d", self->tabela_processos[self->processo_atual_idx].pid);
+  if (self->nucleo->processo_atual_idx != -1) {
+    console_printf("SO: Processo escolhido. PID = %d", self->tabela_processos[self->nucleo->processo_atual_idx].pid);
   } else {
     console_printf("SO: Nenhum processo pronto. CPU ociosa.");
   }
@@ -752,25 +1685,26 @@ static void so_escalona(so_t *self)
 static int so_despacha(so_t *self)
 {
   // se não há processo a executar, avisa a CPU para parar
-  if (self->processo_atual_idx == NENHUM_PROCESSO) {
+  if (self->nucleo->processo_atual_idx == NENHUM_PROCESSO) {
     // T3
     // Diz à MMU para não usar nenhuma tabela (desliga a tradução)
-    mmu_define_tabpag(self->mmu, NULL);
+    mmu_define_tabpag(self->nucleo->mmu, NULL);
     return 1; // Retorna 1 para o assembly, que fará a CPU parar (PARA)
   }
 
   // obtém um ponteiro para o PCB do processo que vai executar
-  processo_t *p = &self->tabela_processos[self->processo_atual_idx];
+  processo_t *p = &self->tabela_processos[self->nucleo->processo_atual_idx];
 
   // T3
   // Diz à MMU para usar a tabela de páginas deste processo
-  mmu_define_tabpag(self->mmu, p->tabpag);
+  mmu_define_tabpag(self->nucleo->mmu, p->tabpag);
+  cpu_define_processo(self->nucleo->cpu, p->pid, p->nome_executavel);
 
   // escreve o estado do processo na memória, de onde a CPU irá restaurá-lo
-  if (mem_escreve(self->mem, CPU_END_PC, p->regPC) != ERR_OK ||
-      mem_escreve(self->mem, CPU_END_A, p->regA) != ERR_OK ||
-      mem_escreve(self->mem, CPU_END_erro, p->regERRO) != ERR_OK ||
-      mem_escreve(self->mem, 59, p->regX) != ERR_OK) 
+  if (mmu_escreve(self->nucleo->mmu, CPU_END_PC, p->regPC, supervisor) != ERR_OK ||
+      mmu_escreve(self->nucleo->mmu, CPU_END_A, p->regA, supervisor) != ERR_OK ||
+      mmu_escreve(self->nucleo->mmu, CPU_END_erro, p->regERRO, supervisor) != ERR_OK ||
+      mmu_escreve(self->nucleo->mmu, 59, p->regX, supervisor) != ERR_OK) 
   {
     console_printf("SO: erro na escrita dos registradores ao despachar processo.");
     self->erro_interno = true;
@@ -807,6 +1741,21 @@ static int so_despacha(so_t *self)
   return 0; // Retorna 0 para o assembly, que fará a CPU retornar da interrupção (RETI)
 }
 
+// termina o processo desta CPU, se outra CPU o matou enquanto ele executava
+static void so_termina_processo_morto(so_t *self)
+{
+  int idx = self->nucleo->processo_a_matar_idx;
+  if (idx == NENHUM_PROCESSO) return;
+  self->nucleo->processo_a_matar_idx = NENHUM_PROCESSO;
+  // pode já ter terminado sozinho, nesta interrupção
+  if (self->tabela_processos[idx].estado == TERMINADO) return;
+
+  so_mata_processo(self, idx);
+  if (self->nucleo->processo_atual_idx == idx) {
+    self->nucleo->processo_atual_idx = NENHUM_PROCESSO;
+  }
+}
+
 
 // ---------------------------------------------------------------------
 // TRATAMENTO DE UMA IRQ {{{1
@@ -850,6 +1799,8 @@ static void so_trata_reset(so_t *self)
     console_printf("SO: problema na carga do programa de tratamento de interrupção");
     self->erro_interno = true;
   }
+  // para o perfil de execução, o tratador é código do SO
+  cpu_define_processo(self->nucleo->cpu, PERFIL_PID_SO, "trata_int.maq");
 
   // programa o relógio para gerar uma interrupção após INTERVALO_INTERRUPCAO
   if (es_escreve(self->es, D_RELOGIO_TIMER, INTERVALO_INTERRUPCAO) != ERR_OK) 
@@ -880,6 +1831,7 @@ static void so_trata_reset(so_t *self)
   
   // Preenche a estrutura do processo (PCB)
   p->pid = self->proximo_pid++;
+  so_registra_processo(self, processo_idx);
   p->estado = PRONTO; // Esta pronto para executar, mas ainda não esta na CPU
   p->regPC = ender; // O contador de programa aponta para o inicio do init
   p->regA = 0;
@@ -893,18 +1845,19 @@ static void so_trata_reset(so_t *self)
   p->num_page_faults = 0; 
 
   p->tipo_bloqueio = BLOQUEIO_NENHUM;
+  p->nivel_mlfq = 0;
+  p->peso = PESO_PADRAO;
+  p->vruntime = self->cfs_vruntime_min;
 
   // Atribui os dispositivos de E/S padrão (Terminal A)
   p->disp_entrada = D_TERM_A_TECLADO;
   p->disp_saida = D_TERM_A_TELA;
 
-  #if ESCALONADOR_ATIVO == ESCALONADOR_ROUND_ROBIN
   // coloca o primeiro processo na fila de prontos
   insere_fila_prontos(self, processo_idx);
-  #endif
 
   // Define o processo atual como -1 para que o escalonador o retire da fila
-  self->processo_atual_idx = -1;
+  self->nucleo->processo_atual_idx = -1;
   
   console_printf("SO: processo 'init' criado com PID %d e inserido na fila.", p->pid);
 }
@@ -914,14 +1867,14 @@ static void so_trata_irq_err_cpu(so_t *self)
 {
 
   // Se não havia processo (NENHUM_PROCESSO), é um erro grave do SO.
-  if (self->processo_atual_idx == NENHUM_PROCESSO) {
+  if (self->nucleo->processo_atual_idx == NENHUM_PROCESSO) {
     console_printf("SO: ERRO FATAL DE CPU SEM PROCESSO ATIVO!");
     self->erro_interno = true;
     return;
   }
 
   // Pega o erro do PCB do processo que o causou
-  processo_t *p = &self->tabela_processos[self->processo_atual_idx];
+  processo_t *p = &self->tabela_processos[self->nucleo->processo_atual_idx];
   err_t err = p->regERRO;
   int complemento = p->regComplemento; // T3 Pega a info extra
   
@@ -963,65 +1916,39 @@ static void so_trata_irq_relogio(so_t *self)
     self->erro_interno = true;
   }
   
-  // LRU AGING
-  #if ALGORITMO_SUBST_ATIVO == ALGORITMO_SUBST_LRU
-  // Se o LRU estiver ativo, envelhece as paginas
-
-  // O T3 pede para envelhecer apenas as paginas do processo corrente.
-  // Uma implementacao alternativa (e comum) e envelhecer TODAS as paginas
-  // na memoria. Vamos seguir o T3.
-
-  if (self->processo_atual_idx != NENHUM_PROCESSO) {
-    processo_t *p_atual = &self->tabela_processos[self->processo_atual_idx];
-    
-    // Itera por TODOS os quadros fisicos
-    for (int q = 0; q < self->max_quadros_fisicos; q++) {
-      // Verifica se este quadro pertence ao processo atual
-      if (self->tabela_quadros_invertida[q].processo_idx == self->processo_atual_idx) {
-        
-        int pag_virt = self->tabela_quadros_invertida[q].pagina_virtual;
-        unsigned int *age = &self->tabela_quadros_invertida[q].age;
-        
-        // 1. Divide por 2 (rodando a direita)
-        *age = *age >> 1; 
-        
-        // 2. Verifica o bit de acesso (R-bit)
-        if (tabpag_bit_acesso(p_atual->tabpag, pag_virt)) {
-          // 3. Adiciona o bit mais significativo
-          // (Assume unsigned int de 32 bits. 1U << 31)
-          *age = *age | (1U << (sizeof(unsigned int) * 8 - 1));
-          
-          // 4. Zera o bit de acesso na tabela de paginas
-          tabpag_zera_bit_acesso(p_atual->tabpag, pag_virt);
-        }
-      }
-    }
+  // a politica de substituicao pode acompanhar a passagem do tempo (o LRU
+  // envelhece as paginas do processo em execucao)
+  if (self->politica->tic != NULL) {
+    self->politica->tic(self);
   }
+
+  #if ESCALONADOR_ATIVO == ESCALONADOR_MLFQ
+  so_mlfq_promove_todos(self);
   #endif
 
   //metricas
-  if (self->processo_atual_idx == -1) 
+  if (self->nucleo->processo_atual_idx == -1) 
   {
     self->tempo_ocioso += INTERVALO_INTERRUPCAO;
   }
 
   // Se não havia processo a ser executado, não há quantum a decrementar
-  if (self->processo_atual_idx == -1) 
+  if (self->nucleo->processo_atual_idx == -1) 
   {
     return;
   }
 
   // Decrementa o quantum restante
-  self->quantum_restante--;
-  console_printf("SO: Interrupcao do relogio, quantum restante = %d", self->quantum_restante);
+  self->nucleo->quantum_restante--;
+  console_printf("SO: Interrupcao do relogio, quantum restante = %d", self->nucleo->quantum_restante);
 
   // Se o quantum acabou, força a preempção
-  if (self->quantum_restante <= 0) 
+  if (self->nucleo->quantum_restante <= 0) 
   {
-    processo_t *p = &self->tabela_processos[self->processo_atual_idx];
+    processo_t *p = &self->tabela_processos[self->nucleo->processo_atual_idx];
     p->num_preempcoes++; // metricas individual 
     self->num_preempcoes_total++; //metricas do sistema
-    console_printf("SO: Quantum esgotado para o processo %d. Preempcao.", self->tabela_processos[self->processo_atual_idx].pid);
+    console_printf("SO: Quantum esgotado para o processo %d. Preempcao.", self->tabela_processos[self->nucleo->processo_atual_idx].pid);
   }
 }
 
@@ -1043,12 +1970,13 @@ static void so_chamada_escr(so_t *self);
 static void so_chamada_cria_proc(so_t *self);
 static void so_chamada_mata_proc(so_t *self);
 static void so_chamada_espera_proc(so_t *self);
+static void so_chamada_muda_peso(so_t *self);
 
 static void so_trata_irq_chamada_sistema(so_t *self)
 {
   // a identificação da chamada está no registrador A
   // t2: com processos, o reg A deve estar no descritor do processo corrente
-  processo_t *p = &self->tabela_processos[self->processo_atual_idx];
+  processo_t *p = &self->tabela_processos[self->nucleo->processo_atual_idx];
   int id_chamada = p->regA; 
   console_printf("SO: chamada de sistema %d", id_chamada);
   switch (id_chamada) {
@@ -1067,6 +1995,9 @@ static void so_trata_irq_chamada_sistema(so_t *self)
     case SO_ESPERA_PROC:
       so_chamada_espera_proc(self);
       break;
+    case SO_MUDA_PESO:
+      so_chamada_muda_peso(self);
+      break;
     default:
       console_printf("SO: chamada de sistema desconhecida (%d)", id_chamada);
       self->erro_interno = true;
@@ -1077,7 +2008,7 @@ static void so_trata_irq_chamada_sistema(so_t *self)
 // faz a leitura de um dado da entrada corrente do processo, coloca o dado no reg A
 static void so_chamada_le(so_t *self)
 {
-  processo_t *p = &self->tabela_processos[self->processo_atual_idx];
+  processo_t *p = &self->tabela_processos[self->nucleo->processo_atual_idx];
   dispositivo_id_t teclado = p->disp_entrada;
   dispositivo_id_t teclado_ok = teclado + TERM_TECLADO_OK - TERM_TECLADO;
   
@@ -1106,8 +2037,9 @@ static void so_chamada_le(so_t *self)
     p->estado = BLOQUEADO;
     p->vezes_bloqueado++; //metricas
     p->tipo_bloqueio = BLOQUEIO_LE;
+    so_espera_dispositivo(self, self->nucleo->processo_atual_idx);
     // Força o escalonador a escolher outro processo
-    self->processo_atual_idx = -1;
+    self->nucleo->processo_atual_idx = -1;
   }
 }
 
@@ -1115,7 +2047,7 @@ static void so_chamada_le(so_t *self)
 // escreve o valor do reg X na saída corrente do processo
 static void so_chamada_escr(so_t *self)
 {
-  processo_t *p = &self->tabela_processos[self->processo_atual_idx];
+  processo_t *p = &self->tabela_processos[self->nucleo->processo_atual_idx];
   dispositivo_id_t tela = p->disp_saida;
   dispositivo_id_t tela_ok = tela + TERM_TELA_OK - TERM_TELA;
 
@@ -1149,8 +2081,9 @@ static void so_chamada_escr(so_t *self)
     p->estado = BLOQUEADO;
     p->vezes_bloqueado++; //metricas
     p->tipo_bloqueio = BLOQUEIO_ESCR;
+    so_espera_dispositivo(self, self->nucleo->processo_atual_idx);
     // Força o escalonador a escolher outro processo
-    self->processo_atual_idx = -1;
+    self->nucleo->processo_atual_idx = -1;
   }
 }
 
@@ -1158,19 +2091,12 @@ static void so_chamada_escr(so_t *self)
 // cria um processo
 static void so_chamada_cria_proc(so_t *self)
 {
-  // o processo que está chamando a criação é o processo pai
-  processo_t *pai = &self->tabela_processos[self->processo_atual_idx];
+  // achar um slot livre na tabela de processos (antes de pegar o ponteiro
+  //   para o pai, porque a tabela pode mudar de lugar ao aumentar)
+  int novo_idx = so_entrada_livre(self);
 
-  // achar um slot livre na tabela de processos
-  int novo_idx = -1;
-  for (int i = 0; i < MAX_PROCESSOS; i++) 
-  {
-    if (self->tabela_processos[i].estado == TERMINADO) 
-    {
-      novo_idx = i;
-      break;
-    }
-  }
+  // o processo que está chamando a criação é o processo pai
+  processo_t *pai = &self->tabela_processos[self->nucleo->processo_atual_idx];
 
   // se não houver slot livre, retorna erro
   if (novo_idx == -1) 
@@ -1183,7 +2109,7 @@ static void so_chamada_cria_proc(so_t *self)
   // ler o nome do programa a ser executado da memória do processo pai
   int ender_nome = pai->regX; // O endereço do nome está no registrador X do pai
   char nome_prog[100];
-  if (!so_copia_str_do_processo(self, 100, nome_prog, ender_nome, self->processo_atual_idx)) 
+  if (!so_copia_str_do_processo(self, 100, nome_prog, ender_nome, self->nucleo->processo_atual_idx)) 
   {
     pai->regA = -1; // Retorno de erro: nome do programa inválido
     console_printf("SO: Nao foi possivel ler o nome do programa para o novo processo.");
@@ -1217,6 +2143,7 @@ static void so_chamada_cria_proc(so_t *self)
   self->num_processos_criados++;
   
   novo->pid = self->proximo_pid++;
+  so_registra_processo(self, novo_idx);
   novo->estado = PRONTO;
   /*
   #if ESCALONADOR_ATIVO == ESCALONADOR_ROUND_ROBIN
@@ -1230,6 +2157,9 @@ static void so_chamada_cria_proc(so_t *self)
   novo->regComplemento = 0; // T3 Inicializa o novo registador
   novo->pid_esperado = -1;
   novo->prioridade = 0.5;
+  novo->nivel_mlfq = 0;
+  novo->peso = PESO_PADRAO;
+  novo->vruntime = self->cfs_vruntime_min;
   
   // T3-
   novo->tempo_termino_io_disco = 0;
@@ -1265,10 +2195,8 @@ static void so_chamada_cria_proc(so_t *self)
   novo->disp_entrada = term_base + TERM_TECLADO;
   novo->disp_saida = term_base + TERM_TELA;
 
-  #if ESCALONADOR_ATIVO == ESCALONADOR_ROUND_ROBIN
   // Coloca o novo processo no fim da fila de prontos
   insere_fila_prontos(self, novo_idx);
-  #endif
 
   // Retornar o PID do novo processo no registrador A do pai
   pai->regA = novo->pid;
@@ -1281,7 +2209,7 @@ static void so_chamada_cria_proc(so_t *self)
 // mata o processo com pid X (ou o processo corrente se X é 0)
 static void so_chamada_mata_proc(so_t *self)
 {
-  processo_t *chamador = &self->tabela_processos[self->processo_atual_idx];
+  processo_t *chamador = &self->tabela_processos[self->nucleo->processo_atual_idx];
   int pid_alvo = chamador->regX; // O PID a ser morto está no registrador X
 
   // Se o PID alvo for 0, o processo quer se matar
@@ -1291,15 +2219,7 @@ static void so_chamada_mata_proc(so_t *self)
   }
 
   // encontrar o processo a ser morto na tabela
-  int idx_alvo = -1;
-  for (int i = 0; i < MAX_PROCESSOS; i++) 
-  {
-    if (self->tabela_processos[i].pid == pid_alvo && self->tabela_processos[i].estado != TERMINADO) 
-    {
-      idx_alvo = i;
-      break;
-    }
-  }
+  int idx_alvo = so_procura_processo(self, pid_alvo);
 
   // se não encontrou o processo, retorna erro
   if (idx_alvo == -1) 
@@ -1309,6 +2229,32 @@ static void so_chamada_mata_proc(so_t *self)
     return;
   }
 
+  // se o processo está executando em outra CPU, só pode ser terminado quando
+  //   ela for interrompida (até lá, ela usa a memória dele)
+  for (int c = 0; c < self->n_nucleos; c++) {
+    nucleo_t *outro = &self->nucleos[c];
+    if (outro != self->nucleo && outro->processo_atual_idx == idx_alvo) {
+      outro->processo_a_matar_idx = idx_alvo;
+      console_printf("SO: Processo com PID %d sera terminado pela CPU %d.", pid_alvo, c);
+      chamador->regA = 0;
+      return;
+    }
+  }
+
+  so_mata_processo(self, idx_alvo);
+
+  if (idx_alvo == self->nucleo->processo_atual_idx) 
+  {
+      self->nucleo->processo_atual_idx = -1;
+  }
+
+  chamador->regA = 0;
+}
+
+// termina o processo 'idx_alvo', liberando sua memória e desbloqueando os
+//   processos que esperavam por ele
+static void so_mata_processo(so_t *self, int idx_alvo)
+{
   // mudar o estado do processo para TERMINADO
   processo_t *alvo = &self->tabela_processos[idx_alvo];
 
@@ -1318,6 +2264,13 @@ static void so_chamada_mata_proc(so_t *self)
   alvo->tempo_termino = tempo_agora;
 
   int pid_morto = alvo->pid; // Guarda o PID antes de o invalidar
+  if (alvo->estado == BLOQUEADO) {
+    so_tira_da_espera(self, idx_alvo);
+  } else if (alvo->estado == PRONTO) {
+    // se estava esperando a vez, não pode mais ser escolhido
+    retira_da_fila_prontos(self, idx_alvo);
+  }
+  so_libera_entrada(self, idx_alvo);
   alvo->estado = TERMINADO;
   alvo->pid = -1; // Libera o PID
 
@@ -1326,57 +2279,48 @@ static void so_chamada_mata_proc(so_t *self)
   if (alvo->tabpag != NULL) {
     console_printf("SO: Libertando tabela de paginas do PID %d.", pid_morto);
 
-    for (int i = 0; i < self->max_quadros_fisicos; i++) {
-      // se o quadro i pertence ao processo que está morrendo
-      if (self->tabela_quadros_invertida[i].processo_idx == idx_alvo) {
-        // Marca como livre (-1)
-        self->tabela_quadros_invertida[i].processo_idx = -1;
-        self->tabela_quadros_invertida[i].pagina_virtual = -1;
-        self->tabela_quadros_invertida[i].age = 0; 
-      }
-    }
+    so_libera_quadros_do_processo(self, idx_alvo);
 
-    // Liberta a estrutura da tabela de páginas
+    // Liberta a estrutura da tabela de páginas e a area no disco
     tabpag_destroi(alvo->tabpag);
     alvo->tabpag = NULL;
+    so_libera_disco(self, alvo);
   }
 
-  console_printf("SO: Processo com PID %d terminado.", pid_alvo);
+  console_printf("SO: Processo com PID %d terminado.", pid_morto);
 
-  // desbloqueia processos que estavam à espera do processo que morreu
-  for (int i = 0; i < MAX_PROCESSOS; i++) 
+  // desbloqueia processos que estavam à espera do processo que morreu,
+  //   na ordem da tabela
+  int *esperando = self->desbloqueados;
+  int n_esperando = 0;
+  for (int i = alvo->primeiro_esperando; i != -1; i = self->tabela_processos[i].prox_espera) {
+    esperando[n_esperando++] = i;
+  }
+  alvo->primeiro_esperando = -1;
+  qsort(esperando, n_esperando, sizeof(int), so__compara_idx);
+  for (int k = 0; k < n_esperando; k++) 
   {
+    int i = esperando[k];
     processo_t *p = &self->tabela_processos[i];
-    if (p->estado == BLOQUEADO && p->tipo_bloqueio == BLOQUEIO_ESPERA && p->pid_esperado == pid_morto) 
-    {
-      
-      p->estado = PRONTO;
-      p->tipo_bloqueio = BLOQUEIO_NENHUM;
-      p->pid_esperado = -1;
-      p->regA = 0; // Retorna 0 (sucesso) para a chamada SO_ESPERA_PROC
-
-      #if ESCALONADOR_ATIVO == ESCALONADOR_ROUND_ROBIN
-      // coloca o novo processo no fim da fila de prontos
-      insere_fila_prontos(self, i);
-      #endif
+    p->idx_esperado = -1;
+    p->prox_espera = -1;
+    p->estado = PRONTO;
+    p->tipo_bloqueio = BLOQUEIO_NENHUM;
+    p->pid_esperado = -1;
+    p->regA = 0; // Retorna 0 (sucesso) para a chamada SO_ESPERA_PROC
 
-      console_printf("SO: Processo %d desbloqueado pois processo %d terminou.", p->pid, pid_morto);
-    }
-  }
+    // coloca o novo processo no fim da fila de prontos
+    insere_fila_prontos(self, i);
 
-  if (alvo->pid == chamador->pid) 
-  {
-      self->processo_atual_idx = -1;
+    console_printf("SO: Processo %d desbloqueado pois processo %d terminou.", p->pid, pid_morto);
   }
-
-  chamador->regA = 0;
 }
 
 // implementação da chamada se sistema SO_ESPERA_PROC
 // espera o fim do processo com pid X
 static void so_chamada_espera_proc(so_t *self)
 {
-  processo_t *chamador = &self->tabela_processos[self->processo_atual_idx];
+  processo_t *chamador = &self->tabela_processos[self->nucleo->processo_atual_idx];
   int pid_alvo = chamador->regX; // O PID a ser esperado está no registador X
 
   // validar o PID alvo
@@ -1389,15 +2333,7 @@ static void so_chamada_espera_proc(so_t *self)
   }
 
   // o processo alvo tem de existir e não pode estar ja terminado
-  int idx_alvo = -1;
-  for (int i = 0; i < MAX_PROCESSOS; i++) 
-  {
-    if (self->tabela_processos[i].pid == pid_alvo && self->tabela_processos[i].estado != TERMINADO) 
-    {
-      idx_alvo = i;
-      break;
-    }
-  }
+  int idx_alvo = so_procura_processo(self, pid_alvo);
 
   // Se nao encontrou um processo valido para esperar, retorna erro
   if (idx_alvo == -1) 
@@ -1412,13 +2348,35 @@ static void so_chamada_espera_proc(so_t *self)
   chamador->vezes_bloqueado++; //metricas
   chamador->tipo_bloqueio = BLOQUEIO_ESPERA;
   chamador->pid_esperado = pid_alvo;
+  so_espera_processo(self, self->nucleo->processo_atual_idx, idx_alvo);
 
   // Força o escalonador a escolher outro processo
-  self->processo_atual_idx = -1;
+  self->nucleo->processo_atual_idx = -1;
 
   console_printf("SO: Processo %d bloqueado, esperando pelo processo %d.", chamador->pid, pid_alvo);
 }
 
+// implementação da chamada de sistema SO_MUDA_PESO
+// muda o peso do processo chamador para o valor em X
+static void so_chamada_muda_peso(so_t *self)
+{
+  processo_t *chamador = &self->tabela_processos[self->nucleo->processo_atual_idx];
+  int peso = chamador->regX;
+
+  if (peso < 1 || peso > PESO_MAXIMO)
+  {
+    chamador->regA = -1; // Retorna erro
+    console_printf("SO: Processo %d tentou mudar o peso para %d, que e invalido.", chamador->pid, peso);
+    return;
+  }
+
+  // o chamador está executando, então não está no heap de prontos; o peso
+  //   novo vale para o tempo virtual a partir de agora
+  chamador->peso = peso;
+  chamador->regA = 0;
+  console_printf("SO: Processo %d agora tem peso %d.", chamador->pid, peso);
+}
+
 
 
 // ---------------------------------------------------------------------
@@ -1428,31 +2386,96 @@ static void so_chamada_espera_proc(so_t *self)
 // Define o tempo de "transferencia" do disco (em instrucoes)
 #define TEMPO_TRANSFERENCIA_DISCO 100
 
+// Numero de blocos (paginas) do disco ocupados pelo processo
+static int so_blocos_no_disco(so_t *self, processo_t *p)
+{
+  int n = (p->tam_memoria + self->tam_pagina - 1) / self->tam_pagina;
+  return n > 0 ? n : 1;
+}
+
+// Aloca no disco a area do processo: a primeira sequencia de blocos livres
+// que couber (first fit). A area e zerada.
+// Retorna o endereco do inicio da area, ou -1 se o disco estiver cheio.
+static int so_aloca_disco(so_t *self, processo_t *p)
+{
+  int n_blocos = so_blocos_no_disco(self, p);
+  int livres = 0;
+  for (int b = 0; b < self->n_blocos_disco; b++) {
+    livres = self->bloco_disco_ocupado[b] ? 0 : livres + 1;
+    if (livres == n_blocos) {
+      int bloco_ini = b - n_blocos + 1;
+      for (int i = bloco_ini; i <= b; i++) {
+        self->bloco_disco_ocupado[i] = true;
+      }
+      int end_ini = bloco_ini * self->tam_pagina;
+      mem_preenche(self->mem_secundaria, end_ini, n_blocos * self->tam_pagina, 0);
+      return end_ini;
+    }
+  }
+  return -1;
+}
+
+// Libera a area do processo no disco
+static void so_libera_disco(so_t *self, processo_t *p)
+{
+  if (p->end_disco < 0) return;
+  int bloco_ini = p->end_disco / self->tam_pagina;
+  int n_blocos = so_blocos_no_disco(self, p);
+  for (int b = bloco_ini; b < bloco_ini + n_blocos; b++) {
+    self->bloco_disco_ocupado[b] = false;
+  }
+  p->end_disco = -1;
+}
+
 // Carrega uma pagina do "disco" (o arquivo .maq) para um quadro da memoria fisica
 static void so_carrega_pagina_do_disco(so_t *self, processo_t *p, int pagina_virtual, int quadro_destino)
 {
-  int end_disco_pagina = p->end_disco + (pagina_virtual * TAM_PAGINA);
-  int end_fisico_quadro = quadro_destino * TAM_PAGINA;
+  int end_disco_pagina = p->end_disco + (pagina_virtual * self->tam_pagina);
+  int end_fisico_quadro = quadro_destino * self->tam_pagina;
 
   console_printf("SO: SWAP IN: Lendo Pagina Virt %d do Disco (End %d) para Quadro Fis %d", pagina_virtual, end_disco_pagina, quadro_destino);
 
-  for (int i = 0; i < TAM_PAGINA; i++) {
-    int dado;
-    // Lê do disco
-    if (mem_le(self->mem_secundaria, end_disco_pagina + i, &dado) == ERR_OK) {
-      // Escreve na RAM
-      mem_escreve(self->mem, end_fisico_quadro + i, dado);
-    } else {
-      // Se ler fora do disco (ex: pagina não inicializada), escreve 0
-      mem_escreve(self->mem, end_fisico_quadro + i, 0);
+  // Copia do disco para a RAM (a area do processo no disco foi zerada na
+  // alocacao, a parte que nao e do programa le 0)
+  mem_copia_bloco(self->mem, end_fisico_quadro, self->mem_secundaria, end_disco_pagina, self->tam_pagina);
+}
+
+// Tira a traducao da pagina das TLBs de todas as CPUs (o processo dono da
+// tabela pode estar executando em qualquer uma delas)
+static void so_invalida_pagina_nas_tlbs(so_t *self, tabpag_t *tabpag, int pagina)
+{
+  int asid = tabpag_asid(tabpag);
+  for (int c = 0; c < self->n_nucleos; c++) {
+    mmu_invalida_pagina(self->nucleos[c].mmu, asid, pagina);
+  }
+}
+
+// Devolve para a pilha de quadros livres todos os quadros do processo
+// (que esta morrendo), tirando-os da politica de substituicao
+static void so_libera_quadros_do_processo(so_t *self, int processo_idx)
+{
+  for (int i = 0; i < self->max_quadros_fisicos; i++) {
+    // se o quadro i pertence ao processo que está morrendo
+    if (self->tabela_quadros_invertida[i].processo_idx == processo_idx) {
+      // Marca como livre (-1)
+      self->politica->quadro_liberado(self, i);
+      self->tabela_quadros_invertida[i].processo_idx = -1;
+      self->tabela_quadros_invertida[i].pagina_virtual = -1;
+      self->pilha_quadros_livres[self->n_quadros_livres++] = i;
+      self->n_quadros_ocupados--;
     }
   }
 }
 
-// Encontra um quadro livre. Por enquanto, so incrementa o contador global
-// Esta e a implementacao mais simples. Nao ha substituicao de pagina.
+// Encontra um quadro livre: primeiro algum devolvido por processo que morreu,
+// senao o proximo nunca usado. Retorna -1 se for necessario substituir.
 static int so_encontra_quadro_livre(so_t *self)
 {
+  if (self->n_quadros_livres > 0) {
+    int quadro = self->pilha_quadros_livres[--self->n_quadros_livres];
+    console_printf("SO: PF Handler: Reutilizando quadro fisico liberado: %d", quadro);
+    return quadro;
+  }
   if (self->n_quadros_ocupados < self->max_quadros_fisicos) 
   {
     // Ainda ha espaco fisico total
@@ -1476,142 +2499,11 @@ static int so_encontra_quadro_livre(so_t *self)
   }
 }
 
-#if ALGORITMO_SUBST_ATIVO == ALGORITMO_SUBST_LRU
-
-// Implementacao do algoritmo de substituicao LRU (Aging)
-static int so_substitui_pagina_lru(so_t *self, long *tempo_swap_out)
-{
-
-  // encontra a vitima (quadro com o menor 'age')
-  int quadro_vitima = -1;
-  unsigned int menor_age = -1; // -1 em unsigned e o maior valor possivel
-
-  // itera por todos os quadros fisicos
-  for (int q = 0; q < self->max_quadros_fisicos; q++) 
-  {
-    // quadro deve estar em uso
-    if (self->tabela_quadros_invertida[q].processo_idx != -1) 
-    {
-      if (self->tabela_quadros_invertida[q].age < menor_age) 
-      {
-        menor_age = self->tabela_quadros_invertida[q].age;
-        quadro_vitima = q;
-      }
-    }
-  }
-
-  // Se (por algum motivo) nao achou (ex: memoria so com ROM), e um erro
-  if (quadro_vitima == -1) 
-  {
-      console_printf("SO: LRU ERRO: Nao achou vitima para substituir!");
-      self->erro_interno = true;
-      *tempo_swap_out = 0;
-      return 0; // Vai causar um erro mais a frente
-  }
-
-  // descobre quem era o dono desse quadro
-  int proc_idx_vitima = self->tabela_quadros_invertida[quadro_vitima].processo_idx;
-  int pag_virt_vitima = self->tabela_quadros_invertida[quadro_vitima].pagina_virtual;
-  processo_t *proc_vitima = &self->tabela_processos[proc_idx_vitima];
-
-  console_printf("SO: SUBSTITUICAO LRU: Quadro %d (P%d, Pag %d, Age %u) e a vitima.", quadro_vitima, proc_vitima->pid, pag_virt_vitima, menor_age);
-
-  // verifica se a pagina esta "suja" (Dirty Bit)
-  if (tabpag_bit_alteracao(proc_vitima->tabpag, pag_virt_vitima)) 
-  {
-    console_printf("SO: LRU: Pagina vitima esta 'suja'. Escrevendo no disco (SWAP OUT).");
-
-    int end_fisico_origem = quadro_vitima * TAM_PAGINA;
-    int end_disco_destino = proc_vitima->end_disco + (pag_virt_vitima * TAM_PAGINA);
-
-    for (int i = 0; i < TAM_PAGINA; i++) 
-    {
-      int dado;
-      if (mem_le(self->mem, end_fisico_origem + i, &dado) == ERR_OK) 
-      {
-          mem_escreve(self->mem_secundaria, end_disco_destino + i, dado);
-      }
-    }
-    *tempo_swap_out = TEMPO_TRANSFERENCIA_DISCO;
-  }
-  else
-  {
-    console_printf("SO: LRU: Pagina %d do P%d (Quadro %d, Age %u) esta LIMPA. Swap out desnecessario.", pag_virt_vitima, proc_vitima->pid, quadro_vitima, menor_age);
-    *tempo_swap_out = 0;
-  }
-
-  // invalida a pagina na tabela de paginas do processo vitima
-  tabpag_invalida_pagina(proc_vitima->tabpag, pag_virt_vitima);
-  
-  // zera os metadados do quadro vitima na tabela invertida
-  self->tabela_quadros_invertida[quadro_vitima].age = 0;
-  
-  // retorna o quadro que esta pronto para ser usado
-  return quadro_vitima;
-}
-
-#endif
-
-#if ALGORITMO_SUBST_ATIVO == ALGORITMO_SUBST_FIFO
-
-// Implementacao do algoritmo de substituicao FIFO
-static int so_substitui_pagina_fifo(so_t *self, long *tempo_swap_out)
-{
-  int quadro_vitima = self->fila_quadros_fifo[self->inicio_fila_fifo];
-  self->inicio_fila_fifo = (self->inicio_fila_fifo + 1) % self->max_quadros_fisicos;
-
-  // descobre quem era o dono desse quadro
-  int proc_idx_vitima = self->tabela_quadros_invertida[quadro_vitima].processo_idx;
-  if (proc_idx_vitima == -1) {
-    console_printf("SO: FIFO: Quadro %d estava livre (processo morreu). Reutilizando.", quadro_vitima);
-    *tempo_swap_out = 0;
-    return quadro_vitima;
-  }
-
-  int pag_virt_vitima = self->tabela_quadros_invertida[quadro_vitima].pagina_virtual;
-  processo_t *proc_vitima = &self->tabela_processos[proc_idx_vitima];
-
-  console_printf("SO: SUBSTITUICAO FIFO: Quadro %d (P%d, Pag %d) e a vitima.",
-                 quadro_vitima, proc_vitima->pid, pag_virt_vitima);
-
-  // verifica se a pagina esta "suja" (Dirty Bit)
-  
-  if (tabpag_bit_alteracao(proc_vitima->tabpag, pag_virt_vitima)) {
-    console_printf("SO: FIFO: Pagina vitima esta 'suja'. Escrevendo no disco (SWAP OUT).");
-
-    int end_fisico_origem = quadro_vitima * TAM_PAGINA;
-    int end_disco_destino = proc_vitima->end_disco + (pag_virt_vitima * TAM_PAGINA);
-    
-    // copia o conteudo da pagina da RAM de volta para o Disco
-    for (int i = 0; i < TAM_PAGINA; i++) {
-      int dado;
-      if (mem_le(self->mem, end_fisico_origem + i, &dado) == ERR_OK) {
-          mem_escreve(self->mem_secundaria, end_disco_destino + i, dado);
-      }
-    }
-
-    *tempo_swap_out = TEMPO_TRANSFERENCIA_DISCO;
-  }
-  else
-  {
-    console_printf("SO: FIFO: Pagina %d do PID %d (Quadro %d) esta LIMPA. Swap out desnecessario.", pag_virt_vitima, proc_vitima->pid, quadro_vitima);
-    *tempo_swap_out = 0;
-  }
-
-  // invalida a pagina na tabela de paginas do processo vitima
-  tabpag_invalida_pagina(proc_vitima->tabpag, pag_virt_vitima);
-
-  // retorna o quadro que esta pronto para ser usado
-  return quadro_vitima;
-}
-
-#endif
-
 static void so_trata_falta_de_pagina(so_t *self)
 {
-  processo_t *p = &self->tabela_processos[self->processo_atual_idx];
+  processo_t *p = &self->tabela_processos[self->nucleo->processo_atual_idx];
   int end_falha = p->regComplemento; // Endereco virtual que causou a falha
-  int pagina_virtual = end_falha / TAM_PAGINA;
+  int pagina_virtual = mmu_pagina(self->nucleo->mmu, end_falha);
 
   // verificar se o endereco e valido
   if (end_falha < 0 || end_falha >= p->tam_memoria) {
@@ -1635,20 +2527,11 @@ static void so_trata_falta_de_pagina(so_t *self)
 
   // se nao ha quadros livres (quadro_destino == -1), precisamos rodar o algoritmo de substituicao.
   if (quadro_destino == -1) {
-    #if ALGORITMO_SUBST_ATIVO == ALGORITMO_SUBST_FIFO
-    quadro_destino = so_substitui_pagina_fifo(self, &tempo_swap_out);
-    #elif ALGORITMO_SUBST_ATIVO == ALGORITMO_SUBST_LRU
-        quadro_destino = so_substitui_pagina_lru(self, &tempo_swap_out);
-    #else
-        #error "Nenhum algoritmo de substituicao valido foi selecionado!"
-    #endif
+    quadro_destino = so_substitui_pagina(self, &tempo_swap_out);
+    if (quadro_destino == -1) return; // erro interno
   }
   else
   {
-    #if ALGORITMO_SUBST_ATIVO == ALGORITMO_SUBST_FIFO
-      self->fila_quadros_fifo[self->fim_fila_fifo] = quadro_destino;
-      self->fim_fila_fifo = (self->fim_fila_fifo + 1) % self->max_quadros_fisicos;
-    #endif
     self->n_quadros_ocupados++;
   }
 
@@ -1659,9 +2542,9 @@ static void so_trata_falta_de_pagina(so_t *self)
   tabpag_define_quadro(p->tabpag, pagina_virtual, quadro_destino);
 
   // atualizar a tabela de quadros invertida
-  self->tabela_quadros_invertida[quadro_destino].processo_idx = self->processo_atual_idx;
+  self->tabela_quadros_invertida[quadro_destino].processo_idx = self->nucleo->processo_atual_idx;
   self->tabela_quadros_invertida[quadro_destino].pagina_virtual = pagina_virtual;
-  self->tabela_quadros_invertida[quadro_destino].age = 0;
+  self->politica->quadro_alocado(self, quadro_destino);
 
   // simular o bloqueio por E/S de disco
   int tempo_agora;
@@ -1688,13 +2571,318 @@ static void so_trata_falta_de_pagina(so_t *self)
   
   // Guarda o tempo de termino em nosso novo campo
   p->tempo_termino_io_disco = tempo_termino_io;
+  heap_insere(self->espera_disco, self->nucleo->processo_atual_idx, tempo_termino_io);
   
   // Forca o escalonador a escolher outro processo
-  self->processo_atual_idx = -1;
+  self->nucleo->processo_atual_idx = -1;
   p->regERRO = ERR_OK;
 }
 
 
+// ---------------------------------------------------------------------
+// SUBSTITUIÇÃO DE PÁGINAS {{{1
+// ---------------------------------------------------------------------
+
+// Retorna o bit de acesso da pagina que esta no quadro (em uso). Se 'zera',
+// zera o bit e tira a pagina das TLBs, para que o proximo acesso o marque de novo
+static bool so_quadro_acessado(so_t *self, int quadro, bool zera)
+{
+  processo_t *dono = &self->tabela_processos[self->tabela_quadros_invertida[quadro].processo_idx];
+  int pagina = self->tabela_quadros_invertida[quadro].pagina_virtual;
+  bool acessado = tabpag_bit_acesso(dono->tabpag, pagina);
+  if (acessado && zera) {
+    tabpag_zera_bit_acesso(dono->tabpag, pagina);
+    so_invalida_pagina_nas_tlbs(self, dono->tabpag, pagina);
+  }
+  return acessado;
+}
+
+// Retorna o bit de alteracao da pagina que esta no quadro (em uso)
+static bool so_quadro_alterado(so_t *self, int quadro)
+{
+  processo_t *dono = &self->tabela_processos[self->tabela_quadros_invertida[quadro].processo_idx];
+  return tabpag_bit_alteracao(dono->tabpag, self->tabela_quadros_invertida[quadro].pagina_virtual);
+}
+
+// Um quadro cujo dono espera o disco: a pagina pode ter acabado de ser
+// carregada para ele, e ainda nao foi usada. As politicas que preferem
+// paginas nao acessadas nao escolhem esses quadros: a pagina recem-carregada
+// seria sempre a escolhida antes de o dono usa-la, e sob pressao de memoria
+// nenhum processo terminaria
+static bool so_quadro_protegido(so_t *self, int quadro)
+{
+  processo_t *dono = &self->tabela_processos[self->tabela_quadros_invertida[quadro].processo_idx];
+  return dono->estado == BLOQUEADO && dono->tipo_bloqueio == BLOQUEIO_PAGINACAO;
+}
+
+// Coloca o quadro no fim da lista circular de quadros em uso (logo antes do
+// primeiro, atras do ponteiro do relogio)
+static void so_lista_quadros_insere(so_t *self, int quadro)
+{
+  int primeiro = self->primeiro_quadro;
+  if (primeiro == -1) {
+    self->prox_quadro[quadro] = quadro;
+    self->ant_quadro[quadro] = quadro;
+    self->primeiro_quadro = quadro;
+    return;
+  }
+  int ultimo = self->ant_quadro[primeiro];
+  self->prox_quadro[ultimo] = quadro;
+  self->ant_quadro[quadro] = ultimo;
+  self->prox_quadro[quadro] = primeiro;
+  self->ant_quadro[primeiro] = quadro;
+}
+
+// Tira o quadro da lista circular de quadros em uso
+static void so_lista_quadros_remove(so_t *self, int quadro)
+{
+  int prox = self->prox_quadro[quadro];
+  if (prox == quadro) {
+    self->primeiro_quadro = -1;
+  } else {
+    int ant = self->ant_quadro[quadro];
+    self->prox_quadro[ant] = prox;
+    self->ant_quadro[prox] = ant;
+    if (self->primeiro_quadro == quadro) self->primeiro_quadro = prox;
+  }
+}
+
+// FIFO: substitui a pagina que esta ha mais tempo na memoria
+static int so_fifo_vitima(so_t *self)
+{
+  return self->primeiro_quadro;
+}
+
+// LRU (aproximado por envelhecimento): substitui a pagina com o menor 'age'
+static void so_lru_alocado(so_t *self, int quadro)
+{
+  self->tabela_quadros_invertida[quadro].age = 0;
+  heap_insere(self->quadros_por_age, quadro, 0);
+}
+
+static void so_lru_liberado(so_t *self, int quadro)
+{
+  self->tabela_quadros_invertida[quadro].age = 0;
+  heap_remove(self->quadros_por_age, quadro);
+}
+
+// Envelhece as paginas: a cada interrupcao do relogio, o 'age' de cada pagina
+// e deslocado para a direita, e recebe o bit de acesso no bit mais significativo
+static void so_lru_tic(so_t *self)
+{
+  // O T3 pede para envelhecer apenas as paginas do processo corrente.
+  // Uma implementacao alternativa (e comum) e envelhecer TODAS as paginas
+  // na memoria. Vamos seguir o T3.
+  if (self->nucleo->processo_atual_idx == NENHUM_PROCESSO) return;
+  processo_t *p_atual = &self->tabela_processos[self->nucleo->processo_atual_idx];
+
+  // Pega (e zera) de uma vez os bits de acesso de todas as paginas do processo
+  int n_palavras = tabpag_palavras_mapa(p_atual->tabpag);
+  tabpag_mapa_t acessos[n_palavras > 0 ? n_palavras : 1];
+  tabpag_coleta_e_zera_acessos(p_atual->tabpag, acessos);
+
+  // Percorre as paginas do processo (as que cabem no mapa), nao os quadros
+  // da memoria: o custo e o do tamanho do processo, nao o da memoria fisica
+  for (int pag_virt = 0; pag_virt < n_palavras * TABPAG_BITS_MAPA; pag_virt++) {
+    int q;
+    if (tabpag_traduz(p_atual->tabpag, pag_virt, &q) != ERR_OK) continue;
+    unsigned int *age = &self->tabela_quadros_invertida[q].age;
+
+    // 1. Divide por 2 (rodando a direita)
+    *age = *age >> 1;
+
+    // 2. Verifica o bit de acesso (R-bit), ja zerado na tabela de paginas
+    tabpag_mapa_t mascara = (tabpag_mapa_t)1 << (pag_virt % TABPAG_BITS_MAPA);
+    if (acessos[pag_virt / TABPAG_BITS_MAPA] & mascara) {
+      // 3. Adiciona o bit mais significativo
+      // (Assume unsigned int de 32 bits. 1U << 31)
+      *age = *age | (1U << (sizeof(unsigned int) * 8 - 1));
+
+      // 4. Tira a pagina da TLB, para que o proximo acesso marque o bit de novo
+      so_invalida_pagina_nas_tlbs(self, p_atual->tabpag, pag_virt);
+    }
+    heap_insere(self->quadros_por_age, q, *age);
+  }
+}
+
+// O quadro em uso com o menor 'age' (o de menor numero em caso de empate)
+// esta no topo do heap. Se ele foi acessado desde o ultimo envelhecimento
+// (que ainda nao entrou no 'age': sem isso a pagina de uma instrucao que usa
+// duas seria tirada para trazer a outra) ou e protegido, ganha uma segunda
+// chance: e envelhecido ali mesmo, como se tivesse sido acessado, e volta
+// para o heap com o 'age' novo. Depois de uma volta pelo heap inteiro, usa
+// o do topo.
+static int so_lru_vitima(so_t *self)
+{
+  int n_quadros = heap_n_itens(self->quadros_por_age);
+  for (int i = 0; i < n_quadros; i++) {
+    int quadro = heap_menor(self->quadros_por_age);
+    bool acessado = so_quadro_acessado(self, quadro, true);
+    if (!acessado && !so_quadro_protegido(self, quadro)) return quadro;
+    unsigned int *age = &self->tabela_quadros_invertida[quadro].age;
+    *age = (*age >> 1) | (1U << (sizeof(unsigned int) * 8 - 1));
+    heap_insere(self->quadros_por_age, quadro, *age);
+  }
+  return heap_menor(self->quadros_por_age);
+}
+
+// Relogio: os quadros ficam em circulo, e o ponteiro avanca ate achar uma
+// pagina nao acessada, zerando o bit de acesso das que passa (cada uma tem
+// uma segunda chance)
+static int so_relogio_vitima(so_t *self)
+{
+  if (self->primeiro_quadro == -1) return -1;
+  while (so_quadro_acessado(self, self->primeiro_quadro, true)) {
+    self->primeiro_quadro = self->prox_quadro[self->primeiro_quadro];
+  }
+  return self->primeiro_quadro;
+}
+
+// Segunda chance melhorada: a segunda chance simples escolhe as mesmas
+// paginas que o relogio; esta considera tambem o bit de alteracao, e prefere
+// uma pagina nao acessada e limpa (que nao precisa ser copiada para o disco)
+// a uma nao acessada e alterada. Cada volta procura primeiro uma limpa, sem
+// mexer nos bits, depois uma alterada, zerando o acesso das que passa.
+// Os quadros protegidos ficam de fora; se todos forem, usa o do ponteiro.
+static int so_segunda_chance_vitima(so_t *self)
+{
+  if (self->primeiro_quadro == -1) return -1;
+  int q = self->primeiro_quadro;
+  bool achou_candidato = false;
+  for (;;) {
+    do {
+      if (!so_quadro_protegido(self, q)) {
+        achou_candidato = true;
+        if (!so_quadro_acessado(self, q, false) && !so_quadro_alterado(self, q)) {
+          self->primeiro_quadro = q;
+          return q;
+        }
+      }
+      q = self->prox_quadro[q];
+    } while (q != self->primeiro_quadro);
+    if (!achou_candidato) return q;
+    do {
+      if (!so_quadro_protegido(self, q) && !so_quadro_acessado(self, q, true)) {
+        self->primeiro_quadro = q;
+        return q;
+      }
+      q = self->prox_quadro[q];
+    } while (q != self->primeiro_quadro);
+  }
+}
+
+// WSClock: como o relogio, mas uma pagina nao acessada so e substituida se
+// estiver fora do conjunto de trabalho (sem acesso ha mais de WSCLOCK_TAU
+// instrucoes) e limpa. Se der a volta sem achar, usa uma alterada fora do
+// conjunto (que vai ser copiada para o disco), senao uma limpa qualquer,
+// senao a do ponteiro. O tempo e o do relogio, nao o tempo virtual de cada
+// processo.
+static void so_wsclock_alocado(so_t *self, int quadro)
+{
+  int agora;
+  es_le(self->es, D_RELOGIO_INSTRUCOES, &agora);
+  self->ultimo_uso[quadro] = agora;
+  so_lista_quadros_insere(self, quadro);
+}
+
+static int so_wsclock_vitima(so_t *self)
+{
+  if (self->primeiro_quadro == -1) return -1;
+  int agora;
+  es_le(self->es, D_RELOGIO_INSTRUCOES, &agora);
+  int alterada_fora = -1;
+  int limpa = -1;
+  int q = self->primeiro_quadro;
+  do {
+    if (so_quadro_acessado(self, q, true)) {
+      self->ultimo_uso[q] = agora;
+    } else {
+      bool alterada = so_quadro_alterado(self, q);
+      if (agora - self->ultimo_uso[q] > WSCLOCK_TAU) {
+        if (!alterada) {
+          self->primeiro_quadro = q;
+          return q;
+        }
+        if (alterada_fora == -1) alterada_fora = q;
+      } else if (!alterada && limpa == -1) {
+        limpa = q;
+      }
+    }
+    q = self->prox_quadro[q];
+  } while (q != self->primeiro_quadro);
+  if (alterada_fora != -1) q = alterada_fora;
+  else if (limpa != -1) q = limpa;
+  self->primeiro_quadro = q;
+  return q;
+}
+
+// As politicas que podem ser escolhidas, pelo nome
+static const politica_subst_t politicas_subst[] = {
+  { "fifo",           so_lista_quadros_insere, so_lista_quadros_remove, NULL,       so_fifo_vitima },
+  { "lru",            so_lru_alocado,          so_lru_liberado,         so_lru_tic, so_lru_vitima },
+  { "relogio",        so_lista_quadros_insere, so_lista_quadros_remove, NULL,       so_relogio_vitima },
+  { "segunda_chance", so_lista_quadros_insere, so_lista_quadros_remove, NULL,       so_segunda_chance_vitima },
+  { "wsclock",        so_wsclock_alocado,      so_lista_quadros_remove, NULL,       so_wsclock_vitima },
+};
+#define N_POLITICAS_SUBST ((int)(sizeof(politicas_subst) / sizeof(politicas_subst[0])))
+
+// Retorna a politica com esse nome, ou NULL se nao houver
+static const politica_subst_t *so_procura_politica_subst(char *nome)
+{
+  for (int i = 0; i < N_POLITICAS_SUBST; i++) {
+    if (strcmp(politicas_subst[i].nome, nome) == 0) return &politicas_subst[i];
+  }
+  return NULL;
+}
+
+// Escolhe pela politica um quadro para substituir, e o libera: se a pagina
+// que esta nele foi alterada, e copiada para o disco (o tempo da copia vai
+// para *tempo_swap_out), e e invalidada na tabela do processo dono.
+// Retorna o quadro, ou -1 se nao houver quadro para substituir.
+static int so_substitui_pagina(so_t *self, long *tempo_swap_out)
+{
+  *tempo_swap_out = 0;
+  int quadro_vitima = self->politica->escolhe_vitima(self);
+  if (quadro_vitima == -1) {
+    console_printf("SO: ERRO: a politica '%s' nao achou vitima para substituir!", self->politica->nome);
+    self->erro_interno = true;
+    return -1;
+  }
+  self->num_substituicoes++;
+
+  // descobre quem era o dono desse quadro
+  int proc_idx_vitima = self->tabela_quadros_invertida[quadro_vitima].processo_idx;
+  int pag_virt_vitima = self->tabela_quadros_invertida[quadro_vitima].pagina_virtual;
+  processo_t *proc_vitima = &self->tabela_processos[proc_idx_vitima];
+
+  console_printf("SO: SUBSTITUICAO (%s): Quadro %d (P%d, Pag %d) e a vitima.",
+                 self->politica->nome, quadro_vitima, proc_vitima->pid, pag_virt_vitima);
+
+  // verifica se a pagina esta "suja" (Dirty Bit)
+  if (tabpag_bit_alteracao(proc_vitima->tabpag, pag_virt_vitima)) {
+    console_printf("SO: Pagina vitima esta 'suja'. Escrevendo no disco (SWAP OUT).");
+
+    int end_fisico_origem = quadro_vitima * self->tam_pagina;
+    int end_disco_destino = proc_vitima->end_disco + (pag_virt_vitima * self->tam_pagina);
+
+    // copia o conteudo da pagina da RAM de volta para o Disco
+    mem_copia_bloco(self->mem_secundaria, end_disco_destino, self->mem, end_fisico_origem,
+                    self->tam_pagina);
+    *tempo_swap_out = TEMPO_TRANSFERENCIA_DISCO;
+  } else {
+    console_printf("SO: Pagina %d do PID %d (Quadro %d) esta LIMPA. Swap out desnecessario.",
+                   pag_virt_vitima, proc_vitima->pid, quadro_vitima);
+  }
+
+  // invalida a pagina na tabela de paginas do processo vitima
+  tabpag_invalida_pagina(proc_vitima->tabpag, pag_virt_vitima);
+  so_invalida_pagina_nas_tlbs(self, proc_vitima->tabpag, pag_virt_vitima);
+  self->politica->quadro_liberado(self, quadro_vitima);
+
+  // retorna o quadro que esta pronto para ser usado
+  return quadro_vitima;
+}
+
 // ---------------------------------------------------------------------
 // CARGA DE PROGRAMA {{{1
 // ---------------------------------------------------------------------
@@ -1755,7 +2943,7 @@ static int so_carrega_programa_na_memoria_virtual(so_t *self, programa_t *progra
   int tam_prog = prog_tamanho(programa);
 
   /// verifica alinhamento
-  if ((end_virt_ini % TAM_PAGINA) != 0) {
+  if ((end_virt_ini % self->tam_pagina) != 0) {
       console_printf("SO: Erro! Programa '%s' nao inicia no comeco de pagina.", nome_prog);
       return -1;
   }
@@ -1766,8 +2954,11 @@ static int so_carrega_programa_na_memoria_virtual(so_t *self, programa_t *progra
   strncpy(processo->nome_executavel, nome_prog, 99);
   processo->nome_executavel[99] = '\0';
 
-  processo->end_disco = self->topo_uso_disco;
-  self->topo_uso_disco += processo->tam_memoria;
+  processo->end_disco = so_aloca_disco(self, processo);
+  if (processo->end_disco < 0) {
+    console_printf("SO: Erro! Disco cheio, nao ha espaco para '%s'.", nome_prog);
+    return -1;
+  }
 
   for (int i = 0; i < tam_prog; i++) 
   {
@@ -1786,8 +2977,8 @@ static int so_carrega_programa_na_memoria_virtual(so_t *self, programa_t *progra
   {
     console_printf("SO: Pre-carregando 'init.maq' (PID %d) fisicamente...", self->proximo_pid);
 
-    int pagina_ini = end_virt_ini / TAM_PAGINA;
-    int pagina_fim = (end_virt_ini + tam_prog - 1) / TAM_PAGINA;
+    int pagina_ini = mmu_pagina(self->nucleo->mmu, end_virt_ini);
+    int pagina_fim = mmu_pagina(self->nucleo->mmu, end_virt_ini + tam_prog - 1);
     int n_paginas = pagina_fim - pagina_ini + 1;
 
     // aloca quadros de memória física para estas páginas
@@ -1797,6 +2988,7 @@ static int so_carrega_programa_na_memoria_virtual(so_t *self, programa_t *progra
     if (quadro_fim >= self->max_quadros_fisicos) {
         console_printf("SO: Erro fatal! Nao ha memoria fisica para carregar o 'init.maq'!");
         self->erro_interno = true;
+        so_libera_disco(self, processo);
         return -1;
     }
 
@@ -1814,27 +3006,18 @@ static int so_carrega_programa_na_memoria_virtual(so_t *self, programa_t *progra
       // atualiza a tabela invertida
       self->tabela_quadros_invertida[quadro_atual].processo_idx = processo_idx;
       self->tabela_quadros_invertida[quadro_atual].pagina_virtual = pagina_atual;
-      self->tabela_quadros_invertida[quadro_atual].age = 0;
-
-      // adiciona na fila FIFO
-      #if ALGORITMO_SUBST_ATIVO == ALGORITMO_SUBST_FIFO
-      self->fila_quadros_fifo[self->fim_fila_fifo] = quadro_atual;
-      self->fim_fila_fifo = (self->fim_fila_fifo + 1) % self->max_quadros_fisicos;
-      #endif
+      self->politica->quadro_alocado(self, quadro_atual);
+      if (self->traco != NULL) {
+        traco_registra_carga(self->traco, tabpag_asid(processo->tabpag), pagina_atual);
+      }
 
-      int end_base_quadro = quadro_atual * TAM_PAGINA;
-      int end_base_virt_pag = pagina_atual * TAM_PAGINA;
+      int end_base_quadro = quadro_atual * self->tam_pagina;
+      int end_base_virt_pag = pagina_atual * self->tam_pagina;
 
-      for (int offset = 0; offset < TAM_PAGINA; offset++) 
-      {
-        int end_v = end_base_virt_pag + offset;
-        int val = 0;
-        if (end_v >= end_virt_ini && end_v < (end_virt_ini + tam_prog)) 
-        {
-          val = prog_dado(programa, end_v);
-        }
-        mem_escreve(self->mem, end_base_quadro + offset, val);
-      }
+      // a pagina ja esta no disco (o programa foi copiado para a area do
+      // processo, zerada na alocacao): copia de la, como num swap in
+      mem_copia_bloco(self->mem, end_base_quadro, self->mem_secundaria,
+                      processo->end_disco + end_base_virt_pag, self->tam_pagina);
     }
     self->quadro_livre = quadro_fim + 1;
     self->n_quadros_ocupados += n_paginas; // Atualiza contador de quadros
@@ -1857,14 +3040,14 @@ if (processo_idx == NENHUM_PROCESSO) return false;
 // Define *temporariamente* a MMU para a tabela de páginas
 // do processo de onde queremos ler
 processo_t *p = &self->tabela_processos[processo_idx];
-tabpag_t *tabpag_original = self->tabela_processos[self->processo_atual_idx].tabpag;
-mmu_define_tabpag(self->mmu, p->tabpag);
+tabpag_t *tabpag_original = self->tabela_processos[self->nucleo->processo_atual_idx].tabpag;
+mmu_define_tabpag(self->nucleo->mmu, p->tabpag);
 
 bool sucesso = true;
 for (int indice_str = 0; indice_str < tam; indice_str++) {
 int caractere;
 // Lê usando o modo usuário para forçar a tradução de endereços
-if (mmu_le(self->mmu, end_virt + indice_str, &caractere, usuario) != ERR_OK) {
+if (mmu_le(self->nucleo->mmu, end_virt + indice_str, &caractere, usuario) != ERR_OK) {
 sucesso = false;
 break;
 }
@@ -1879,7 +3062,7 @@ break; // Sucesso, string copiada
 }
 
 // Restaura a tabela de páginas original (do processo que estava executando)
-mmu_define_tabpag(self->mmu, tabpag_original);
+mmu_define_tabpag(self->nucleo->mmu, tabpag_original);
 
 return sucesso;
 }
@@ -13,13 +13,37 @@ typedef struct so_t so_t;
 #include "cpu.h"
 #include "es.h"
 #include "console.h" // só para uma gambiarra
+#include <stdbool.h>
 
 so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu,
               es_t *es, console_t *console);
 void so_destroi(so_t *self);
 
+// acrescenta mais uma CPU, com a sua MMU, às gerenciadas pelo SO (a
+//   primeira é a passada para so_cria); até MAX_CPUS
+// cada CPU executa um processo; os processos prontos ficam em uma fila por
+//   CPU, e uma CPU com a fila vazia pega processos da fila de outra
+void so_adiciona_cpu(so_t *self, cpu_t *cpu, mmu_t *mmu);
+
+// define a política de substituição de páginas, pelo nome: "fifo", "lru"
+//   (aproximado por envelhecimento, a padrão), "relogio", "segunda_chance"
+//   (melhorada, que considera também o bit de alteração) ou "wsclock"
+// deve ser chamada antes do início da simulação
+// retorna false se não existir política com esse nome
+bool so_define_politica_subst(so_t *self, char *nome);
+
+// passa a registrar as páginas referenciadas pelos processos, em todas as
+//   CPUs, para que o relatório compare as faltas de página da política com
+//   as do algoritmo ótimo nas mesmas referências (ver traco.h)
+void so_registra_traco(so_t *self);
+
 void so_gera_relatorio(so_t *self); 
 
+// salva ou carrega o estado do SO (ver snapshot.h): processos, com suas
+//   tabelas de páginas, filas, quadros e a memória secundária
+// ao carregar, redefine a tabela de páginas da MMU e o processo da CPU
+void so_snapshot(so_t *self, snapshot_t *snap);
+
 // Chamadas de sistema
 // Uma chamada de sistema é realizada colocando a identificação da
 //   chamada (um dos valores abaixo) no registrador A e executando a
@@ -79,4 +103,11 @@ void so_gera_relatorio(so_t *self);
 // retorna sem bloquear, com erro, se não existir processo com esse pid
 #define SO_ESPERA_PROC 9
 
+// muda o peso do processo chamador no escalonador
+// só tem efeito com o escalonador CFS, em que o tempo de CPU de cada processo
+//   é proporcional ao seu peso
+// recebe em X o novo peso, de 1 a 65536; o peso inicial é 1024
+// retorna em A: 0 se OK ou um código de erro negativo
+#define SO_MUDA_PESO   10
+
 #endif // SO_H
@@ -8,17 +8,38 @@
 #include <assert.h>
 
 // estrutura auxiliar, contém informação sobre uma página
+// os bits de acesso e alteração ficam fora dos descritores, em mapas de bits
+//   (ver tabpag__bits_t)
 typedef struct {
   // quadro da memória principal correspondente à página
   int quadro;
   // a página está mapeada ou não
   bool valida;
-  // a página foi acessada ou não
-  bool acessada;
-  // a página foi alterada ou não
-  bool alterada;
 } descritor_t;
 
+// os bits de acesso e de alteração de todas as páginas, um bit por página
+// só páginas válidas têm bits ligados
+// os mapas só crescem, para conter a maior página já definida
+typedef struct {
+  int n_palavras;
+  tabpag_mapa_t *acesso;
+  tabpag_mapa_t *alteracao;
+} tabpag__bits_t;
+
+// a organização da tabela é escolhida na compilação (ver Makefile):
+// - plana: um vetor de descritores, do tamanho necessário para conter a
+//   maior página válida; muda de tamanho (realloc) quando essa página muda
+// - em dois níveis: o número da página é dividido em duas partes; a mais
+//   alta escolhe uma folha (um vetor de descritores de tamanho fixo) em um
+//   diretório, a mais baixa escolhe o descritor dentro da folha; as folhas
+//   são alocadas quando recebem a primeira página, e nada é liberado quando
+//   páginas são invalidadas (só na destruição da tabela)
+// as duas implementam as mesmas funções auxiliares (tabpag__inicializa,
+//   tabpag__libera, tabpag__descritor, tabpag__insere_pagina,
+//   tabpag__remove_pagina e tabpag__tam), que são usadas pelo resto do código
+
+#ifndef TABPAG_NIVEIS
+
 struct tabpag_t {
   // número de descritores na tabela (pode ser 0)
   int tam_tab;
@@ -26,36 +47,56 @@ struct tabpag_t {
   // o último descritor do vetor sempre contém uma página válida
   // pode ser NULL (se tam_tab == 0)
   descritor_t *tabela;
+  // versão do mapeamento, alterada a cada mudança de tradução
+  unsigned versao;
+  // identificador do espaço de endereçamento
+  int asid;
+  // bits de acesso e alteração
+  tabpag__bits_t bits;
 };
 
-tabpag_t *tabpag_cria(void)
+static void tabpag__inicializa(tabpag_t *self)
 {
-  tabpag_t *self = malloc(sizeof(*self));
-  assert(self != NULL);
   self->tam_tab = 0;
   self->tabela = NULL;
-  return self;
 }
 
-void tabpag_destroi(tabpag_t *self)
+static void tabpag__libera(tabpag_t *self)
 {
-  if (self != NULL) {
-    if (self->tabela != NULL) free(self->tabela);
-    free(self);
-  }
+  if (self->tabela != NULL) free(self->tabela);
+  tabpag__inicializa(self);
 }
 
-// retorna true se a página for válida (pode ser traduzida em um quadro)
-static bool tabpag__pagina_valida(tabpag_t *self, int pagina)
+// retorna o descritor da página, ou NULL se ele não existir na tabela
+static descritor_t *tabpag__descritor(tabpag_t *self, int pagina)
 {
-  if (pagina < 0 || pagina >= self->tam_tab) return false;
-  return self->tabela[pagina].valida;
+  if (pagina < 0 || pagina >= self->tam_tab) return NULL;
+  return &self->tabela[pagina];
 }
 
-void tabpag_invalida_pagina(tabpag_t *self, int pagina)
+// aumenta a tabela, se necessário, para que contenha 'pagina'
+// retorna o descritor da página
+static descritor_t *tabpag__insere_pagina(tabpag_t *self, int pagina)
+{
+  if (pagina < self->tam_tab) return &self->tabela[pagina];
+  int novo_tam = pagina + 1;
+  if (self->tam_tab == 0) {
+    self->tabela = malloc(novo_tam * sizeof(descritor_t));
+  } else {
+    self->tabela = realloc(self->tabela, novo_tam * sizeof(descritor_t));
+  }
+  assert(self->tabela != NULL);
+  // marca as páginas inseridas como não válidas
+  while (self->tam_tab < novo_tam) {
+    self->tabela[self->tam_tab].valida = false;
+    self->tam_tab++;
+  }
+  return &self->tabela[pagina];
+}
+
+// marca como inválida a página, que é válida
+static void tabpag__remove_pagina(tabpag_t *self, int pagina)
 {
-  // página já é inválida -- não faz nada
-  if (!tabpag__pagina_valida(self, pagina)) return;
   // página não é a última da tabela -- marca como inválida
   if (pagina < self->tam_tab - 1) {
     self->tabela[pagina].valida = false;
@@ -74,64 +115,300 @@ void tabpag_invalida_pagina(tabpag_t *self, int pagina)
   }
 }
 
-// aumenta a tabela, se necessário, para que contenha 'pagina'
-static void tabpag__insere_pagina(tabpag_t *self, int pagina)
+// retorna o número da maior página válida mais 1 (0 se não houver)
+static int tabpag__tam(tabpag_t *self)
 {
-  if (pagina < self->tam_tab) return;
-  int novo_tam = pagina + 1;
-  if (self->tam_tab == 0) {
-    self->tabela = malloc(novo_tam * sizeof(descritor_t));
-  } else {
-    self->tabela = realloc(self->tabela, novo_tam * sizeof(descritor_t));
+  return self->tam_tab;
+}
+
+#else // TABPAG_NIVEIS
+
+// número de bits da parte baixa do número da página, que escolhe o descritor
+//   dentro da folha
+#define BITS_FOLHA 6
+#define TAM_FOLHA (1 << BITS_FOLHA)
+
+struct tabpag_t {
+  // número de entradas no diretório (pode ser 0)
+  int n_folhas;
+  // diretório, com ponteiros para as folhas; uma folha sem nenhuma página
+  //   definida é NULL
+  // só cresce, para conter a folha da maior página já definida
+  descritor_t **folhas;
+  // versão do mapeamento, alterada a cada mudança de tradução
+  unsigned versao;
+  // identificador do espaço de endereçamento
+  int asid;
+  // bits de acesso e alteração
+  tabpag__bits_t bits;
+};
+
+static void tabpag__inicializa(tabpag_t *self)
+{
+  self->n_folhas = 0;
+  self->folhas = NULL;
+}
+
+static void tabpag__libera(tabpag_t *self)
+{
+  for (int f = 0; f < self->n_folhas; f++) {
+    free(self->folhas[f]);
   }
-  assert(self->tabela != NULL);
-  // marca as páginas inseridas como não válidas
-  while (self->tam_tab < novo_tam) {
-    self->tabela[self->tam_tab].valida = false;
-    self->tam_tab++;
+  free(self->folhas);
+  tabpag__inicializa(self);
+}
+
+// retorna o descritor da página, ou NULL se ele não existir na tabela
+static descritor_t *tabpag__descritor(tabpag_t *self, int pagina)
+{
+  if (pagina < 0) return NULL;
+  int f = pagina >> BITS_FOLHA;
+  if (f >= self->n_folhas || self->folhas[f] == NULL) return NULL;
+  return &self->folhas[f][pagina & (TAM_FOLHA - 1)];
+}
+
+// aloca, se necessário, a folha que contém 'pagina' (e aumenta o diretório)
+// retorna o descritor da página
+static descritor_t *tabpag__insere_pagina(tabpag_t *self, int pagina)
+{
+  int f = pagina >> BITS_FOLHA;
+  if (f >= self->n_folhas) {
+    // o diretório cresce pelo menos para o dobro, para não ser realocado a
+    //   cada folha nova no final do espaço de endereçamento
+    int novo_n = f + 1;
+    if (novo_n < 2 * self->n_folhas) novo_n = 2 * self->n_folhas;
+    self->folhas = realloc(self->folhas, novo_n * sizeof(*self->folhas));
+    assert(self->folhas != NULL);
+    while (self->n_folhas < novo_n) {
+      self->folhas[self->n_folhas++] = NULL;
+    }
+  }
+  if (self->folhas[f] == NULL) {
+    // as páginas da folha nova começam não válidas (calloc zera)
+    self->folhas[f] = calloc(TAM_FOLHA, sizeof(descritor_t));
+    assert(self->folhas[f] != NULL);
+  }
+  return &self->folhas[f][pagina & (TAM_FOLHA - 1)];
+}
+
+// marca como inválida a página, que é válida
+// a folha continua alocada, mesmo que fique sem páginas válidas
+static void tabpag__remove_pagina(tabpag_t *self, int pagina)
+{
+  tabpag__descritor(self, pagina)->valida = false;
+}
+
+// retorna o número da maior página válida mais 1 (0 se não houver)
+static int tabpag__tam(tabpag_t *self)
+{
+  for (int f = self->n_folhas - 1; f >= 0; f--) {
+    if (self->folhas[f] == NULL) continue;
+    for (int d = TAM_FOLHA - 1; d >= 0; d--) {
+      if (self->folhas[f][d].valida) return (f << BITS_FOLHA) + d + 1;
+    }
+  }
+  return 0;
+}
+
+#endif // TABPAG_NIVEIS
+
+// fonte das versões das tabelas -- é global para que uma tabela criada no
+//   lugar de outra que foi destruída não repita uma versão antiga
+static unsigned tabpag__proxima_versao = 0;
+// idem para os ASIDs
+static int tabpag__proximo_asid = 0;
+
+// registra que o mapeamento da tabela mudou
+static void tabpag__nova_versao(tabpag_t *self)
+{
+  self->versao = ++tabpag__proxima_versao;
+}
+
+// palavra e máscara do bit da página nos mapas de bits
+#define PALAVRA(pagina) ((pagina) / TABPAG_BITS_MAPA)
+#define MASCARA(pagina) ((tabpag_mapa_t)1 << ((pagina) % TABPAG_BITS_MAPA))
+
+// aumenta os mapas de bits, se necessário, para que contenham 'pagina'
+static void tabpag__insere_bits(tabpag_t *self, int pagina)
+{
+  tabpag__bits_t *bits = &self->bits;
+  if (PALAVRA(pagina) < bits->n_palavras) return;
+  int novo_n = PALAVRA(pagina) + 1;
+  if (novo_n < 2 * bits->n_palavras) novo_n = 2 * bits->n_palavras;
+  bits->acesso = realloc(bits->acesso, novo_n * sizeof(tabpag_mapa_t));
+  bits->alteracao = realloc(bits->alteracao, novo_n * sizeof(tabpag_mapa_t));
+  assert(bits->acesso != NULL && bits->alteracao != NULL);
+  while (bits->n_palavras < novo_n) {
+    bits->acesso[bits->n_palavras] = 0;
+    bits->alteracao[bits->n_palavras] = 0;
+    bits->n_palavras++;
+  }
+}
+
+// zera os bits de uma página válida
+static void tabpag__zera_bits(tabpag_t *self, int pagina)
+{
+  self->bits.acesso[PALAVRA(pagina)] &= ~MASCARA(pagina);
+  self->bits.alteracao[PALAVRA(pagina)] &= ~MASCARA(pagina);
+}
+
+// retorna o bit da página no mapa; a página pode estar fora do mapa
+static bool tabpag__bit(tabpag_t *self, tabpag_mapa_t *mapa, int pagina)
+{
+  if (pagina < 0 || PALAVRA(pagina) >= self->bits.n_palavras) return false;
+  return (mapa[PALAVRA(pagina)] & MASCARA(pagina)) != 0;
+}
+
+tabpag_t *tabpag_cria(void)
+{
+  tabpag_t *self = malloc(sizeof(*self));
+  assert(self != NULL);
+  tabpag__inicializa(self);
+  self->bits.n_palavras = 0;
+  self->bits.acesso = NULL;
+  self->bits.alteracao = NULL;
+  tabpag__nova_versao(self);
+  self->asid = ++tabpag__proximo_asid;
+  return self;
+}
+
+void tabpag_destroi(tabpag_t *self)
+{
+  if (self != NULL) {
+    tabpag__libera(self);
+    free(self->bits.acesso);
+    free(self->bits.alteracao);
+    free(self);
   }
 }
 
+// retorna o descritor da página se ela for válida (pode ser traduzida em
+//   um quadro), ou NULL
+static descritor_t *tabpag__descritor_valido(tabpag_t *self, int pagina)
+{
+  descritor_t *desc = tabpag__descritor(self, pagina);
+  if (desc == NULL || !desc->valida) return NULL;
+  return desc;
+}
+
+void tabpag_invalida_pagina(tabpag_t *self, int pagina)
+{
+  // página já é inválida -- não faz nada
+  if (tabpag__descritor_valido(self, pagina) == NULL) return;
+  tabpag__nova_versao(self);
+  tabpag__zera_bits(self, pagina);
+  tabpag__remove_pagina(self, pagina);
+}
+
 void tabpag_define_quadro(tabpag_t *self, int pagina, int quadro)
 {
   assert(pagina >= 0);
-  tabpag__insere_pagina(self, pagina);
-  self->tabela[pagina].quadro = quadro;
-  self->tabela[pagina].valida = true;
-  self->tabela[pagina].acessada = false;
-  self->tabela[pagina].alterada = false;
+  descritor_t *desc = tabpag__insere_pagina(self, pagina);
+  desc->quadro = quadro;
+  desc->valida = true;
+  tabpag__insere_bits(self, pagina);
+  tabpag__zera_bits(self, pagina);
+  tabpag__nova_versao(self);
 }
 
 void tabpag_marca_bit_acesso(tabpag_t *self, int pagina, bool alteracao)
 {
-  if (!tabpag__pagina_valida(self, pagina)) return;
-  self->tabela[pagina].acessada = true;
+  if (tabpag__descritor_valido(self, pagina) == NULL) return;
+  self->bits.acesso[PALAVRA(pagina)] |= MASCARA(pagina);
   if (alteracao) {
-    self->tabela[pagina].alterada = true;
+    self->bits.alteracao[PALAVRA(pagina)] |= MASCARA(pagina);
   }
 }
 
+// como só páginas válidas têm bits ligados, as funções abaixo não precisam
+//   consultar o descritor
+
 void tabpag_zera_bit_acesso(tabpag_t *self, int pagina)
 {
-  if (!tabpag__pagina_valida(self, pagina)) return;
-  self->tabela[pagina].acessada = false;
+  if (!tabpag__bit(self, self->bits.acesso, pagina)) return;
+  self->bits.acesso[PALAVRA(pagina)] &= ~MASCARA(pagina);
 }
 
 bool tabpag_bit_acesso(tabpag_t *self, int pagina)
 {
-  if (!tabpag__pagina_valida(self, pagina)) return false;
-  return self->tabela[pagina].acessada;
+  return tabpag__bit(self, self->bits.acesso, pagina);
 }
 
 bool tabpag_bit_alteracao(tabpag_t *self, int pagina)
 {
-  if (!tabpag__pagina_valida(self, pagina)) return false;
-  return self->tabela[pagina].alterada;
+  return tabpag__bit(self, self->bits.alteracao, pagina);
+}
+
+int tabpag_palavras_mapa(tabpag_t *self)
+{
+  return self->bits.n_palavras;
+}
+
+void tabpag_coleta_e_zera_acessos(tabpag_t *self, tabpag_mapa_t *mapa)
+{
+  for (int i = 0; i < self->bits.n_palavras; i++) {
+    mapa[i] = self->bits.acesso[i];
+    self->bits.acesso[i] = 0;
+  }
 }
 
 err_t tabpag_traduz(tabpag_t *self, int pagina, int *pquadro)
 {
-  if (!tabpag__pagina_valida(self, pagina)) return ERR_PAG_AUSENTE;
-  *pquadro = self->tabela[pagina].quadro;
+  descritor_t *desc = tabpag__descritor_valido(self, pagina);
+  if (desc == NULL) return ERR_PAG_AUSENTE;
+  *pquadro = desc->quadro;
   return ERR_OK;
 }
+
+unsigned tabpag_versao(tabpag_t *self)
+{
+  return self->versao;
+}
+
+int tabpag_asid(tabpag_t *self)
+{
+  return self->asid;
+}
+
+// o formato é o mesmo nas duas organizações da tabela
+void tabpag_snapshot(tabpag_t *self, snapshot_t *snap)
+{
+  int tam_tab = tabpag__tam(self);
+  snapshot_int(snap, &tam_tab);
+  if (snapshot_carregando(snap)) {
+    if (tam_tab < 0) {
+      snapshot_erro(snap);
+      return;
+    }
+    tabpag__libera(self);
+    for (int i = 0; i < self->bits.n_palavras; i++) {
+      self->bits.acesso[i] = 0;
+      self->bits.alteracao[i] = 0;
+    }
+    tabpag__nova_versao(self);
+  }
+  // só as páginas válidas têm quadro e bits
+  bool ultima_valida = false;
+  for (int pagina = 0; pagina < tam_tab; pagina++) {
+    descritor_t desc = { .valida = false };
+    descritor_t *pdesc = tabpag__descritor(self, pagina);
+    if (pdesc != NULL) desc = *pdesc;
+    snapshot_bool(snap, &desc.valida);
+    ultima_valida = desc.valida;
+    if (!desc.valida) continue;
+    bool acessada = tabpag_bit_acesso(self, pagina);
+    bool alterada = tabpag_bit_alteracao(self, pagina);
+    snapshot_int(snap, &desc.quadro);
+    snapshot_bool(snap, &acessada);
+    snapshot_bool(snap, &alterada);
+    if (snapshot_carregando(snap)) {
+      *tabpag__insere_pagina(self, pagina) = desc;
+      tabpag__insere_bits(self, pagina);
+      if (acessada) self->bits.acesso[PALAVRA(pagina)] |= MASCARA(pagina);
+      if (alterada) self->bits.alteracao[PALAVRA(pagina)] |= MASCARA(pagina);
+    }
+  }
+  if (tam_tab > 0 && !ultima_valida) {
+    snapshot_erro(snap);
+  }
+}
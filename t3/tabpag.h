@@ -13,11 +13,18 @@
 // mantém para cada página mapeada um bit de acesso e um bit de alteração
 
 #include "err.h"
+#include "snapshot.h"
 #include <stdbool.h>
 
 // tipo opaco que representa a tabela de páginas
 typedef struct tabpag_t tabpag_t;
 
+// palavra de um mapa de bits com um bit por página (ver
+//   tabpag_coleta_e_zera_acessos): o bit da página p é o bit
+//   p % TABPAG_BITS_MAPA da palavra p / TABPAG_BITS_MAPA
+typedef unsigned long tabpag_mapa_t;
+#define TABPAG_BITS_MAPA ((int)(8 * sizeof(tabpag_mapa_t)))
+
 // cria uma tabela de páginas
 // retorna um ponteiro para um descritor, que deverá ser usado em todas
 //   as operações nessa tabela
@@ -56,9 +63,36 @@ bool tabpag_bit_acesso(tabpag_t *self, int pagina);
 // retorna false se a página for inválida
 bool tabpag_bit_alteracao(tabpag_t *self, int pagina);
 
+// retorna o número de palavras de um mapa de bits que contém todas as
+//   páginas válidas da tabela
+int tabpag_palavras_mapa(tabpag_t *self);
+
+// copia os bits de acesso de todas as páginas para 'mapa', que deve ter
+//   tabpag_palavras_mapa() palavras, e zera esses bits na tabela
+// equivale a chamar tabpag_bit_acesso e tabpag_zera_bit_acesso para cada
+//   página, mas é feito uma palavra por vez
+void tabpag_coleta_e_zera_acessos(tabpag_t *self, tabpag_mapa_t *mapa);
+
 // traduz a página 'pagina'; coloca o quadro correspondente na posição apontada
 //   por 'pquadro'
 // retorna ERR_PAG_AUSENTE (e não altera '*pquadro') se a página for inválida
 err_t tabpag_traduz(tabpag_t *self, int pagina, int *pquadro);
 
+// retorna a versão do mapeamento da tabela
+// a versão muda sempre que a tradução de alguma página é alterada (por
+//   tabpag_define_quadro ou tabpag_invalida_pagina), e nunca se repete entre
+//   tabelas diferentes; quem guarda resultados de tradução (como o cache de
+//   instruções da CPU) pode usá-la para saber se esses resultados ainda valem
+unsigned tabpag_versao(tabpag_t *self);
+
+// retorna o identificador do espaço de endereçamento (ASID) da tabela
+// é maior que 0, definido na criação e nunca se repete entre tabelas
+//   diferentes; a TLB da MMU usa o ASID para guardar traduções de várias
+//   tabelas ao mesmo tempo (ver mmu_invalida_pagina)
+int tabpag_asid(tabpag_t *self);
+
+// salva ou carrega o conteúdo da tabela (ver snapshot.h)
+// ao carregar, a tabela recebe uma nova versão
+void tabpag_snapshot(tabpag_t *self, snapshot_t *snap);
+
 #endif // TABPAG_H
@@ -148,6 +148,19 @@ void terminal_tictac(terminal_t *self)
   terminal_atualiza_limpeza(self);
 }
 
+void terminal_snapshot(terminal_t *self, snapshot_t *snap)
+{
+  int estado = self->estado_saida;
+  snapshot_confere(snap, self->tam_linha);
+  snapshot_str(snap, self->tam_linha + 1, self->entrada);
+  // durante a rolagem a linha de saída pode ter caracteres depois do '\0'
+  snapshot_bytes(snap, self->tam_linha + 1, self->saida);
+  snapshot_int(snap, &estado);
+  snapshot_int(snap, &self->pos_rolagem);
+  if (estado < normal || estado > limpando) snapshot_erro(snap);
+  else self->estado_saida = estado;
+}
+
 char *terminal_txt_entrada(terminal_t *self)
 {
   return self->entrada;
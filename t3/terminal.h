@@ -35,6 +35,7 @@
 
 #include <stdbool.h>
 #include "err.h"
+#include "snapshot.h"
 
 typedef struct terminal_t terminal_t;
 
@@ -65,6 +66,9 @@ void terminal_limpa_saida(terminal_t *self);
 // esta função deve ser chamada periodicamente
 void terminal_tictac(terminal_t *self);
 
+// salva ou carrega o estado do terminal (ver snapshot.h)
+void terminal_snapshot(terminal_t *self, snapshot_t *snap);
+
 // Funções para implementar o protocolo de acesso a um dispositivo pelo
 //   controlador de E/S
 // Devem seguir o protocolo f_leitura_t e f_escrita_t declarados em es.h
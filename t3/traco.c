@@ -0,0 +1,174 @@
+// traco.c
+// traço de referências a páginas, e o algoritmo ótimo sobre ele
+// simulador de computador
+// so25b
+
+#include "traco.h"
+#include "heap.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+struct traco_t {
+  int n;          // número de referências
+  int n_carga;    // as primeiras n_carga são páginas carregadas antes
+  int cap;        // capacidade dos vetores
+  int *asid;
+  int *pagina;
+};
+
+traco_t *traco_cria(void)
+{
+  traco_t *self = malloc(sizeof(*self));
+  assert(self != NULL);
+  self->n = 0;
+  self->n_carga = 0;
+  self->cap = 0;
+  self->asid = NULL;
+  self->pagina = NULL;
+  return self;
+}
+
+void traco_destroi(traco_t *self)
+{
+  free(self->asid);
+  free(self->pagina);
+  free(self);
+}
+
+void traco_registra(traco_t *self, int asid, int pagina)
+{
+  if (self->n > 0 && self->asid[self->n - 1] == asid
+      && self->pagina[self->n - 1] == pagina) {
+    return;
+  }
+  if (self->n == self->cap) {
+    self->cap = self->cap == 0 ? 1024 : 2 * self->cap;
+    self->asid = realloc(self->asid, self->cap * sizeof(*self->asid));
+    self->pagina = realloc(self->pagina, self->cap * sizeof(*self->pagina));
+    assert(self->asid != NULL && self->pagina != NULL);
+  }
+  self->asid[self->n] = asid;
+  self->pagina[self->n] = pagina;
+  self->n++;
+}
+
+void traco_registra_carga(traco_t *self, int asid, int pagina)
+{
+  assert(self->n == self->n_carga);
+  traco_registra(self, asid, pagina);
+  self->n_carga = self->n;
+}
+
+int traco_tam(traco_t *self)
+{
+  return self->n - self->n_carga;
+}
+
+// tabela de espalhamento que numera as páginas distintas do traço (0, 1, ...),
+//   para o algoritmo ótimo usar vetores indexados pelo número
+typedef struct {
+  int tam;        // potência de 2
+  int n;          // páginas numeradas
+  long *chave;    // asid e página; -1 se a posição está livre
+  int *num;
+} numeracao_t;
+
+static long traco__chave(int asid, int pagina)
+{
+  return ((long)asid << 32) | (unsigned)pagina;
+}
+
+static void traco__inicia_numeracao(numeracao_t *num, int tam)
+{
+  num->tam = tam;
+  num->n = 0;
+  num->chave = malloc(tam * sizeof(*num->chave));
+  num->num = malloc(tam * sizeof(*num->num));
+  assert(num->chave != NULL && num->num != NULL);
+  for (int i = 0; i < tam; i++) num->chave[i] = -1;
+}
+
+// retorna a posição de 'chave' na tabela, ou a posição livre onde ela deve ficar
+static int traco__posicao(numeracao_t *num, long chave)
+{
+  int i = (int)(((unsigned long)chave * 0x9E3779B97F4A7C15UL) >> 32) & (num->tam - 1);
+  while (num->chave[i] != -1 && num->chave[i] != chave) {
+    i = (i + 1) & (num->tam - 1);
+  }
+  return i;
+}
+
+// retorna o número da página, numerando-a se ainda não tiver
+static int traco__numera(numeracao_t *num, long chave)
+{
+  int i = traco__posicao(num, chave);
+  if (num->chave[i] == chave) return num->num[i];
+  if (2 * (num->n + 1) > num->tam) {
+    // mantém a tabela no máximo meio cheia
+    numeracao_t maior;
+    traco__inicia_numeracao(&maior, 2 * num->tam);
+    for (int j = 0; j < num->tam; j++) {
+      if (num->chave[j] == -1) continue;
+      int k = traco__posicao(&maior, num->chave[j]);
+      maior.chave[k] = num->chave[j];
+      maior.num[k] = num->num[j];
+    }
+    maior.n = num->n;
+    free(num->chave);
+    free(num->num);
+    *num = maior;
+    i = traco__posicao(num, chave);
+  }
+  num->chave[i] = chave;
+  num->num[i] = num->n;
+  return num->n++;
+}
+
+long traco_faltas_otimo(traco_t *self, int n_quadros)
+{
+  if (self->n == self->n_carga) return 0;
+  if (n_quadros < 1) return self->n - self->n_carga;
+
+  // numera as páginas distintas
+  int *id = malloc(self->n * sizeof(*id));
+  assert(id != NULL);
+  numeracao_t num;
+  traco__inicia_numeracao(&num, 1024);
+  for (int i = 0; i < self->n; i++) {
+    id[i] = traco__numera(&num, traco__chave(self->asid[i], self->pagina[i]));
+  }
+  int n_paginas = num.n;
+  free(num.chave);
+  free(num.num);
+
+  // prox[i] é a posição da próxima referência à página referenciada em i,
+  //   ou self->n se não for mais referenciada
+  int *prox = malloc(self->n * sizeof(*prox));
+  int *seguinte = malloc(n_paginas * sizeof(*seguinte));
+  assert(prox != NULL && seguinte != NULL);
+  for (int p = 0; p < n_paginas; p++) seguinte[p] = self->n;
+  for (int i = self->n - 1; i >= 0; i--) {
+    prox[i] = seguinte[id[i]];
+    seguinte[id[i]] = i;
+  }
+  free(seguinte);
+
+  // as páginas na memória ficam em um heap, com a próxima referência mais
+  //   distante primeiro (a chave é o negativo da posição)
+  heap_t *memoria = heap_cria(n_paginas);
+  long faltas = 0;
+  for (int i = 0; i < self->n; i++) {
+    if (!heap_contem(memoria, id[i])) {
+      if (i >= self->n_carga) faltas++;
+      if (heap_n_itens(memoria) == n_quadros) {
+        heap_remove(memoria, heap_menor(memoria));
+      }
+    }
+    heap_insere(memoria, id[i], -(long)prox[i]);
+  }
+  heap_destroi(memoria);
+  free(prox);
+  free(id);
+  return faltas;
+}
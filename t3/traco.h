@@ -0,0 +1,45 @@
+// traco.h
+// traço de referências a páginas, e o algoritmo ótimo sobre ele
+// simulador de computador
+// so25b
+
+#ifndef TRACO_H
+#define TRACO_H
+
+// o traço é a sequência das páginas referenciadas pelos processos, cada uma
+//   identificada pelo ASID da tabela de páginas (ver tabpag_asid) e pelo
+//   número da página
+// referências seguidas à mesma página são registradas uma vez só (não
+//   mudam o número de faltas de página de nenhum algoritmo)
+// com o traço completo dá para calcular as faltas de página do algoritmo
+//   ótimo (de Belady), que substitui a página que vai demorar mais para ser
+//   referenciada de novo -- ele precisa conhecer o futuro, então não pode ser
+//   usado na execução, mas serve de referência para comparar os outros
+
+typedef struct traco_t traco_t;
+
+// cria um traço vazio
+traco_t *traco_cria(void);
+
+// destrói um traço
+// nenhuma outra operação pode ser realizada no traço após esta chamada
+void traco_destroi(traco_t *self);
+
+// registra uma referência à página 'pagina' da tabela com ASID 'asid'
+void traco_registra(traco_t *self, int asid, int pagina);
+
+// registra a página 'pagina' da tabela com ASID 'asid' como carregada na
+//   memória antes da execução (sem falta de página), como as do init
+// deve ser chamada antes de qualquer traco_registra
+void traco_registra_carga(traco_t *self, int asid, int pagina);
+
+// retorna o número de referências registradas (sem contar as cargas)
+int traco_tam(traco_t *self);
+
+// retorna o número de faltas de página que o algoritmo ótimo teria com as
+//   referências do traço, em uma memória com 'n_quadros' quadros, que
+//   começam com as páginas carregadas (as primeiras referências a cada uma
+//   das outras páginas contam)
+long traco_faltas_otimo(traco_t *self, int n_quadros);
+
+#endif // TRACO_H